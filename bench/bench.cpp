@@ -0,0 +1,206 @@
+/**
+ * Simulator Microbenchmarks
+ * Measures the throughput of the simulator's hot paths: cache lookups,
+ * bus snoops and trace parsing, across associativities and block sizes.
+ * Each benchmark doubles its iteration count until a run takes at least
+ * MIN_TIME seconds, then reports time per operation like Google Benchmark.
+ * Usage: ./bench_coherence [FILTER]  (runs benchmarks whose name contains FILTER)
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../utils/bus.h"
+#include "../utils/global_lock.h"
+#include "../utils/lru_cache.h"
+#include "../utils/processor.h"
+#include "../utils/trace.h"
+
+const double MIN_TIME = 0.2;
+std::string filter;
+// Results are accumulated here so the compiler cannot drop the work
+volatile long sink;
+
+// fn(iterations) performs iterations operations
+void run_benchmark(const std::string& name, std::function<void(long)> fn)
+{
+    if (name.find(filter) == std::string::npos)
+        return;
+    long iterations = 1;
+    double seconds = 0;
+    while (true)
+    {
+        auto start = std::chrono::steady_clock::now();
+        fn(iterations);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        seconds = elapsed.count();
+        if (seconds >= MIN_TIME || iterations >= (1l << 40))
+            break;
+        iterations *= 2;
+    }
+    printf("%-48s %12.2f ns %14ld iterations %10.2f M items/s\n",
+           name.c_str(), seconds * 1e9 / iterations, iterations, iterations / seconds / 1e6);
+}
+
+// A complete system of num_cores cores whose traces are never run
+struct System {
+    GlobalLock *gl;
+    Bus *bus;
+    std::vector<Processor*> cores;
+
+    System(Protocol protocol, int num_cores, int cache_size, int associativity, int block_size)
+    {
+        gl = new GlobalLock(cache_size, associativity, block_size);
+        if (protocol == Protocol::MESI)
+            bus = new MESI_Bus(cache_size, associativity, block_size, false, gl);
+        else
+            bus = new Dragon_Bus(cache_size, associativity, block_size, false, gl);
+        bus->init_memory(new FlatMemory(100));
+        std::vector<LRUCache*> caches;
+        for (int pid = 0; pid < num_cores; ++pid)
+        {
+            cores.push_back(new Processor(pid, protocol, new SyntheticTrace(SyntheticConfig(), pid, block_size),
+                                          cache_size, associativity, block_size, bus, gl));
+            caches.push_back(cores.back()->get_cache());
+        }
+        bus->init_cores(cores);
+        bus->init_cache(caches);
+    }
+};
+
+void bench_cache_lookup(Protocol protocol, const std::string& protocol_name)
+{
+    const int cache_size = 65536;
+    for (int block_size : {32, 64})
+    {
+        for (int associativity : {1, 2, 4, 8, 16})
+        {
+            System system(protocol, 4, cache_size, associativity, block_size);
+            LRUCache *cache = system.cores[0]->get_cache();
+            int num_sets = cache->num_sets;
+            std::string config = "/" + std::to_string(associativity) + "way/" + std::to_string(block_size) + "B";
+
+            // Every block of the cache, so every access after warm-up hits
+            run_benchmark(protocol_name + "_Cache/read_hit" + config, [&](long iterations) {
+                for (long i = 0; i < iterations; ++i)
+                    cache->pr_read(i % num_sets, (i / num_sets) % associativity);
+            });
+            run_benchmark(protocol_name + "_Cache/write_hit" + config, [&](long iterations) {
+                for (long i = 0; i < iterations; ++i)
+                    cache->pr_write(i % num_sets, (i / num_sets) % associativity);
+            });
+            // Twice the ways of each set, so LRU always evicts
+            run_benchmark(protocol_name + "_Cache/read_miss" + config, [&](long iterations) {
+                for (long i = 0; i < iterations; ++i)
+                    cache->pr_read(i % num_sets, (i / num_sets) % (2 * associativity));
+            });
+        }
+    }
+}
+
+void bench_bus(Protocol protocol, const std::string& protocol_name)
+{
+    for (int num_cores : {4, 16, 64})
+    {
+        System system(protocol, num_cores, 65536, 4, 64);
+        int num_sets = system.cores[0]->get_cache()->num_sets;
+        // Every core holds the blocks, so each snoop finds sharers
+        for (Processor *core : system.cores)
+        {
+            for (int i = 0; i < num_sets; ++i)
+                core->get_cache()->pr_read(i, 0);
+        }
+        std::string config = "/" + std::to_string(num_cores) + "cores";
+        run_benchmark(protocol_name + "_Bus/BusRd" + config, [&](long iterations) {
+            for (long i = 0; i < iterations; ++i)
+                system.bus->BusRd(0, i % num_sets, 0);
+        });
+        // MESI invalidates the sharers, so they are made sharers again before
+        // each snoop; the time includes those num_cores - 1 state writes
+        int shared = protocol == Protocol::MESI ? (int)MESI_status::S : (int)Dragon_status::Sc;
+        run_benchmark(protocol_name + "_Bus/BusUpd" + config, [&](long iterations) {
+            for (long i = 0; i < iterations; ++i)
+            {
+                for (int pid = 1; pid < num_cores; ++pid)
+                    system.cores[pid]->get_cache()->set_status(i % num_sets, 0, shared);
+                system.bus->BusUpd(0, i % num_sets, 0);
+            }
+        });
+    }
+}
+
+void bench_trace_parsing()
+{
+    // A bodytrack-like text trace and its binary conversion
+    const long num_records = 1000000;
+    std::string text_path = "/tmp/bench_coherence_trace.data";
+    std::string binary_path = "/tmp/bench_coherence_trace.bin";
+    SyntheticConfig config;
+    config.accesses = num_records / 2;
+    SyntheticTrace synthetic(config, 0, 32);
+    FILE *text = fopen(text_path.c_str(), "w");
+    FILE *binary = fopen(binary_path.c_str(), "wb");
+    fwrite(BINARY_TRACE_MAGIC, 1, sizeof(BINARY_TRACE_MAGIC), binary);
+    TraceRecord record;
+    while (synthetic.next(record))
+    {
+        fprintf(text, "%u 0x%lx\n", record.label, record.value);
+        uint8_t label = record.label;
+        int64_t value = record.value;
+        fwrite(&label, 1, 1, binary);
+        fwrite(&value, sizeof(value), 1, binary);
+    }
+    fclose(text);
+    fclose(binary);
+
+    for (const std::string& path : {text_path, binary_path})
+    {
+        std::string name = path == text_path ? "Trace/text" : "Trace/binary";
+        run_benchmark(name, [&](long iterations) {
+            TraceSource *trace = open_trace(path);
+            TraceRecord r = {0, 0};
+            long sum = 0;
+            for (long i = 0; i < iterations; ++i)
+            {
+                sum += r.value;
+                if (!trace->next(r))
+                {
+                    delete trace;
+                    trace = open_trace(path);
+                }
+            }
+            sink = sum;
+            delete trace;
+        });
+    }
+    run_benchmark("Trace/synthetic", [&](long iterations) {
+        SyntheticConfig unbounded;
+        unbounded.accesses = iterations;
+        SyntheticTrace trace(unbounded, 0, 32);
+        TraceRecord r = {0, 0};
+        long sum = 0;
+        for (long i = 0; i < iterations; ++i)
+        {
+            trace.next(r);
+            sum += r.value;
+        }
+        sink = sum;
+    });
+    remove(text_path.c_str());
+    remove(binary_path.c_str());
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1)
+        filter = argv[1];
+    bench_cache_lookup(Protocol::MESI, "MESI");
+    bench_cache_lookup(Protocol::Dragon, "Dragon");
+    bench_bus(Protocol::MESI, "MESI");
+    bench_bus(Protocol::Dragon, "Dragon");
+    bench_trace_parsing();
+    return 0;
+}
@@ -1,15 +1,38 @@
+#include <chrono>
+#include <climits>
+#include <filesystem>
 #include <iostream>
-#include <thread>
 #include <cstring>
 #include <string>
+#include <vector>
 
 #include "utils/config.h"
 #include "utils/processor.h"
 #include "utils/bus.h"
 #include "utils/global_lock.h"
 #include "utils/logger.h"
+#include "utils/engine.h"
+#include "utils/options.h"
+#include "utils/results_cache.h"
+
+int main(int _argc, char* _argv[]) {
+    // Split --key=value options from the positional arguments
+    Options options;
+    std::vector<char*> positional;
+    for (int i = 0; i < _argc; ++i)
+    {
+        if (strncmp(_argv[i], "--", 2) != 0)
+            positional.push_back(_argv[i]);
+        else if (!options.parse(_argv[i]))
+        {
+            std::cout << "ERROR: Unknown or malformed option " << _argv[i] << "." << std::endl;
+            Options::print_usage();
+            return 0;
+        }
+    }
+    int argc = positional.size();
+    char **argv = positional.data();
 
-int main(int argc, char* argv[]) {
     if (argc != 3 && argc != 6 && argc != 7)
     {
         std::cout << "ERROR: " << argc << " argument(s) doesn't match format." << std::endl;
@@ -17,6 +40,10 @@ int main(int argc, char* argv[]) {
         std::cout << "  1. Standard: ./coherence <PROTOCOL> <BENCHMARK> <CACHE_SIZE> <ASSOCIATIVITY> <BLOCK_SIZE>" << std::endl;
         std::cout << "  2. Use default cache size, associativity and block size: ./coherence <PROTOCOL> <BENCHMARK>" << std::endl;
         std::cout << "  3. Optimized MESI: ./coherence <PROTOCOL> <BENCHMARK> <CACHE_SIZE> <ASSOCIATIVITY> <BLOCK_SIZE> true" << std::endl;
+        std::cout << "<PROTOCOL> is MESI, Dragon or Hybrid (Dragon with self-invalidation of unused copies)" << std::endl;
+        std::cout << "<BENCHMARK> is blackscholes, bodytrack, fluidanimate, synthetic, a directory of per-core traces" << std::endl;
+        std::cout << "or a manifest file of \"[<core>] <trace path>\" lines." << std::endl;
+        Options::print_usage();
         return 0;
     }
 
@@ -31,9 +58,11 @@ int main(int argc, char* argv[]) {
         protocol = Protocol::MESI;
     else if (strcmp(argv[1], "Dragon") == 0)
         protocol = Protocol::Dragon;
+    else if (strcmp(argv[1], "Hybrid") == 0)
+        protocol = Protocol::Hybrid;
     else
     {
-        std::cout << "ERROR: Unknown protocol " << argv[1] << ". Only MESI and Dragon are supported." << std::endl;
+        std::cout << "ERROR: Unknown protocol " << argv[1] << ". Only MESI, Dragon and Hybrid are supported." << std::endl;
         return 0;
     }
 
@@ -43,9 +72,63 @@ int main(int argc, char* argv[]) {
         benchmark = Benchmark::bodytrack;
     else if (strcmp(argv[2], "fluidanimate") == 0)
         benchmark = Benchmark::fluidanimate;
+    else if (strcmp(argv[2], "synthetic") == 0)
+        benchmark = Benchmark::synthetic;
+    else if (std::filesystem::exists(argv[2]))
+        benchmark = Benchmark::manifest;
     else 
     {
-        std::cout << "ERROR: Unknown benchmark " << argv[3] << ". Only blackscholes, bodytrack and fluidanimate are supported." << std::endl;
+        std::cout << "ERROR: Unknown benchmark " << argv[2] << ". Only blackscholes, bodytrack, fluidanimate, synthetic and trace manifests are supported." << std::endl;
+        return 0;
+    }
+
+    // The DRAM queues are shared by all cores, so their clocks must stay within
+    // a quantum of each other
+    if (options.dram && options.quantum == 0)
+    {
+        std::cout << "ERROR: --memory=dram needs --quantum, free-running cores drift too far apart to share the DRAM queues." << std::endl;
+        return 0;
+    }
+
+    // Trace file of each software thread, one per core unless --sched time-shares them
+    std::vector<std::string> trace_paths;
+    int num_threads;
+    if (benchmark == Benchmark::manifest)
+    {
+        if (!read_manifest(argv[2], trace_paths))
+            return 0;
+        if (options.cores == 0)
+            options.cores = trace_paths.size();
+        num_threads = options.cores;
+        if (options.sched != SchedulingMode::one_per_core)
+            num_threads = options.sw_threads > 0 ? options.sw_threads : trace_paths.size();
+        if (num_threads > (int)trace_paths.size())
+        {
+            const char *unit = options.sched == SchedulingMode::one_per_core ? " cores" : " threads";
+            std::cout << "ERROR: " << num_threads << unit << " need as many traces, but " << argv[2] << " lists "
+                      << trace_paths.size() << "." << std::endl;
+            return 0;
+        }
+        if (num_threads < (int)trace_paths.size())
+        {
+            std::cout << "WARNING: Only the first " << num_threads << " of the " << trace_paths.size() << " traces in "
+                      << argv[2] << " are simulated." << std::endl;
+            trace_paths.resize(num_threads);
+        }
+    }
+    else
+    {
+        if (options.cores == 0)
+            options.cores = 4;
+        num_threads = options.cores;
+        if (options.sched != SchedulingMode::one_per_core && options.sw_threads > 0)
+            num_threads = options.sw_threads;
+        for (int tid = 0; benchmark != Benchmark::synthetic && tid < num_threads; ++tid)
+            trace_paths.push_back(Processor::trace_path(benchmark, tid));
+    }
+    if (options.cores == 0)
+    {
+        std::cout << "ERROR: No traces found in " << argv[2] << "." << std::endl;
         return 0;
     }
 
@@ -60,7 +143,16 @@ int main(int argc, char* argv[]) {
     for (int i = 2; i < argc; ++i)
     {
         arguments += "_";
-        arguments += argv[i];
+        if (i == 2 && benchmark == Benchmark::manifest)
+        {
+            // Name logs after the manifest or directory, not its full path
+            std::filesystem::path manifest_path(argv[2]);
+            if (!manifest_path.has_filename())
+                manifest_path = manifest_path.parent_path();
+            arguments += manifest_path.filename().string();
+        }
+        else
+            arguments += argv[i];
     }
     if (argc == 3)
     {
@@ -71,34 +163,134 @@ int main(int argc, char* argv[]) {
         optimize = true;
     }
     
+    std::string cache_key;
+    if (options.cache)
+    {
+        ResultsCache results_cache(arguments + ";" + options.describe(), trace_paths);
+        cache_key = results_cache.get_key();
+        std::string cached_log = "results/" + arguments + "_" + cache_key + ".log";
+        if (results_cache.contains(cached_log))
+        {
+            std::cout << "DONE: The output summary can be found at " << cached_log << " (cached)" << std::endl;
+            return 0;
+        }
+    }
+
+    if (options.validate && !trace_paths.empty())
+    {
+        long max_address = (long)INT_MAX * block_size * ((cache_size / block_size) / associativity);
+        if (!validate_traces(trace_paths, max_address, benchmark != Benchmark::manifest))
+            return 0;
+    }
+
     GlobalLock *gl = new GlobalLock(cache_size, associativity, block_size);
 
     Bus *bus;
     if (protocol == Protocol::MESI)
         bus = new MESI_Bus(cache_size, associativity, block_size, optimize, gl);
-    else
+    else if (protocol == Protocol::Dragon)
         bus = new Dragon_Bus(cache_size, associativity, block_size, optimize, gl);
+    else
+        bus = new Hybrid_Bus(cache_size, associativity, block_size, optimize, gl, options.hybrid_threshold);
 
-    Processor* core0 = new Processor(0, protocol, benchmark, cache_size, associativity, block_size, bus, gl);
-    Processor* core1 = new Processor(1, protocol, benchmark, cache_size, associativity, block_size, bus, gl);
-    Processor* core2 = new Processor(2, protocol, benchmark, cache_size, associativity, block_size, bus, gl);
-    Processor* core3 = new Processor(3, protocol, benchmark, cache_size, associativity, block_size, bus, gl);
+    if (options.dram)
+    {
+        const Latency &timing = options.latency.defaults;
+        bus->init_memory(new DRAM(options.dram_channels, options.dram_banks, options.dram_row_size, block_size, options.dram_policy,
+                                  timing.dram_cas, timing.dram_rcd, timing.dram_rp, timing.dram_burst));
+    }
+    else
+        bus->init_memory(new FlatMemory(options.latency.defaults.memory));
 
-    bus->init_cores(core0, core1, core2, core3);
-    bus->init_cache(core0->get_cache(), core1->get_cache(), core2->get_cache(), core3->get_cache());
+    if (options.sockets > 1)
+    {
+        if (options.sockets > options.cores)
+        {
+            std::cout << "ERROR: " << options.sockets << " sockets need at least as many cores." << std::endl;
+            return 0;
+        }
+        const Latency &latency = options.latency.defaults;
+        bus->init_numa(new Numa(options.sockets, options.cores, options.numa_policy, options.numa_page_size,
+                                latency.remote_memory, latency.remote_transfer, latency.remote_snoop, latency.remote_directory));
+    }
 
-    Logger logger(core0, core1, core2, core3, arguments, block_size);
+    std::vector<Processor*> cores;
+    std::vector<TraceSource*> traces;
+    for (int tid = 0; tid < num_threads; ++tid)
+    {
+        if (benchmark == Benchmark::synthetic)
+            traces.push_back(new SyntheticTrace(options.synthetic, tid, block_size));
+        else
+            traces.push_back(open_trace(trace_paths[tid]));
+    }
+    Scheduler *scheduler = nullptr;
+    if (options.sched != SchedulingMode::one_per_core)
+        scheduler = new Scheduler(options.sched, options.time_slice, options.cores, traces);
 
-    std::thread t0(&Processor::run, core0);
-    std::thread t1(&Processor::run, core1);
-    std::thread t2(&Processor::run, core2);
-    std::thread t3(&Processor::run, core3);
+    for (int pid = 0; pid < options.cores; ++pid)
+    {
+        TraceSource *trace = scheduler == nullptr ? traces[pid] : nullptr;
+        cores.push_back(new Processor(pid, protocol, trace, cache_size, associativity, block_size, bus, gl));
+        if (scheduler != nullptr)
+            cores.back()->init_scheduler(scheduler);
+        cores.back()->init_latency(options.latency.for_core(pid));
+        cores.back()->streaming_stores = options.streaming_stores;
+        cores.back()->collapse = options.collapse;
+        if (options.store_buffer > 0)
+            cores.back()->init_store_buffer(new StoreBuffer(options.store_buffer));
+        if (options.victim_entries > 0)
+            cores.back()->init_victim_cache(new VictimCache(options.victim_entries));
+    }
 
-    t0.join();
-    t1.join();
-    t2.join();
-    t3.join();
+    if (options.page_size > 0)
+    {
+        PageTable *page_table = new PageTable(options.page_size, options.page_policy, cache_size / associativity);
+        for (Processor *core : cores)
+            core->init_tlb(new TLB(options.tlb_entries, options.tlb_associativity, options.tlb_miss_latency, page_table));
+    }
+
+    if (options.interval_accesses > 0 || options.interval_cycles > 0)
+    {
+        for (Processor *core : cores)
+            core->init_intervals(new IntervalRecorder(options.interval_accesses, options.interval_cycles));
+    }
+
+    EventTracer *events = nullptr;
+    if (!options.events.empty())
+    {
+        events = new EventTracer(options.events, options.cores, protocol);
+        if (!events->is_open())
+            return 0;
+        bus->init_events(events);
+    }
+
+    std::vector<LRUCache*> caches;
+    for (Processor *core : cores)
+        caches.push_back(core->get_cache());
+    bus->init_cores(cores);
+    bus->init_cache(caches);
+
+    Logger logger(cores, bus, arguments, block_size, cache_key);
+
+    Engine engine(cores, options.quantum, options.threads);
+    auto start = std::chrono::steady_clock::now();
+    engine.run();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (events)
+    {
+        events->stop();
+        std::cout << "DONE: " << events->count_events << " coherence events written to " << options.events << std::endl;
+    }
+    long accesses = 0;
+    for (Processor *core : cores)
+        accesses += core->get_count_mem_instr();
+    std::cout << "Simulated in " << elapsed.count() << " s";
+    if (options.quantum > 0)
+        std::cout << " (quantum " << options.quantum << ", " << engine.num_threads << " host thread(s))";
+    std::cout << ", " << accesses << " accesses at " << accesses / elapsed.count() / 1e6 << " M accesses/s" << std::endl;
 
+    logger.print_memory_footprint();
+    logger.print_lock_contention();
     logger.print_summary();
 
     // For printing analysis results
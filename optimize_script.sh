@@ -11,8 +11,8 @@ for protocol in "${protocols[@]}"; do
         for cache_size in "${cache_sizes[@]}"; do
             for associativity in "${associativities[@]}"; do
                 for block_size in "${block_sizes[@]}"; do
-                    ./coherence "$protocol" "$benchmark" "$cache_size" "$associativity" "$block_size"
-                    ./coherence "$protocol" "$benchmark" "$cache_size" "$associativity" "$block_size" "optimized"
+                    ./coherence "$protocol" "$benchmark" "$cache_size" "$associativity" "$block_size" --cache
+                    ./coherence "$protocol" "$benchmark" "$cache_size" "$associativity" "$block_size" "optimized" --cache
                 done
             done
         done
@@ -0,0 +1,30 @@
+#!/bin/bash
+# Invalidate (MESI), update (Dragon) and hybrid protocols on the same traces.
+# Prints overall cycles, bus data traffic and invalidations or updates per run.
+
+protocols=("MESI" "Dragon" "Hybrid")
+benchmarks=("blackscholes" "bodytrack" "fluidanimate")
+patterns=("uniform" "producer-consumer" "migratory" "false-sharing")
+
+summarize() {
+    log=$(sed -n 's/^DONE: The output summary can be found at //p')
+    awk '/^1\. /{s=1; next} /^6\. /{s=6; next} /^7\. /{s=7; next} /^-/{s=0}
+         s==1 && /^Core/{if ($3 > cycles) cycles = $3}
+         s==6 && /^[0-9]/{traffic = $1}
+         s==7 && /^[0-9]/{updates = $1}
+         END {printf "cycles=%s traffic=%s invalidations/updates=%s\n", cycles, traffic, updates}' "$log"
+}
+
+for benchmark in "${benchmarks[@]}"; do
+    for protocol in "${protocols[@]}"; do
+        echo -n "$protocol $benchmark: "
+        ./coherence "$protocol" "$benchmark" 4096 2 32 --quantum=1000 | summarize
+    done
+done
+
+for pattern in "${patterns[@]}"; do
+    for protocol in "${protocols[@]}"; do
+        echo -n "$protocol synthetic $pattern: "
+        ./coherence "$protocol" synthetic 4096 2 32 --syn-pattern="$pattern" --quantum=1000 | summarize
+    done
+done
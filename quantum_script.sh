@@ -0,0 +1,17 @@
+#!/bin/bash
+# Speedup of the quantum engine over a single host thread, per quantum size.
+# Prints wall-clock seconds for each run and the resulting speedup.
+
+protocols=("MESI" "Dragon")
+benchmark="bodytrack"
+quantums=(10 100 1000 10000 100000)
+host_threads=$(nproc)
+
+for protocol in "${protocols[@]}"; do
+    for quantum in "${quantums[@]}"; do
+        serial=$(./coherence "$protocol" "$benchmark" --quantum="$quantum" --threads=1 | sed -n 's/^Simulated in \([0-9.e+-]*\) s.*/\1/p')
+        parallel=$(./coherence "$protocol" "$benchmark" --quantum="$quantum" --threads="$host_threads" | sed -n 's/^Simulated in \([0-9.e+-]*\) s.*/\1/p')
+        speedup=$(awk -v s="$serial" -v p="$parallel" 'BEGIN { printf "%.2f", s / p }')
+        echo "$protocol quantum=$quantum serial=${serial}s parallel(${host_threads})=${parallel}s speedup=${speedup}x"
+    done
+done
@@ -0,0 +1,71 @@
+#!/bin/bash
+# Golden-output regression tests on the bundled bodytrack traces and on
+# small synthetic workloads.
+# Every case runs on a single host thread so its log is deterministic, and
+# its log is compared against regression/golden/<case>.log.
+# Usage: ./regression/run.sh [--update]   (--update rewrites the golden logs)
+
+cd "$(dirname "$0")/.." || exit 1
+
+cases=(
+    "MESI bodytrack 1024 1 32"
+    "MESI bodytrack 4096 2 32"
+    "MESI bodytrack 65536 4 64"
+    "MESI bodytrack 4096 2 32 optimized"
+    "Dragon bodytrack 1024 1 32"
+    "Dragon bodytrack 4096 2 32"
+    "Dragon bodytrack 65536 4 64"
+    "MESI bodytrack 4096 2 32 --memory=dram"
+    "Dragon bodytrack 16384 4 64 --page-size=4K --page-policy=coloring"
+    "MESI synthetic 4096 2 32 --syn-pattern=migratory --syn-accesses=20000"
+    "MESI synthetic 4096 2 32 optimized --syn-pattern=migratory --syn-accesses=20000"
+    "Dragon synthetic 4096 2 32 --syn-pattern=false-sharing --syn-accesses=20000"
+    "Hybrid synthetic 4096 2 32 --syn-pattern=producer-consumer --syn-accesses=20000"
+    "MESI bodytrack 1024 1 32 --victim=4"
+    "MESI synthetic 4096 2 32 --sched=round-robin --sw-threads=6 --time-slice=20000 --syn-accesses=20000"
+)
+
+failed=0
+for case in "${cases[@]}"; do
+    name=$(echo "$case" | tr ' ' '_' | tr -d '-' | tr '=' '_')
+    golden="regression/golden/$name.log"
+    log=$(./coherence $case --quantum=1000 --threads=1 | sed -n 's/^DONE: The output summary can be found at \(.*\)$/\1/p')
+    if [ -z "$log" ]; then
+        echo "FAIL $case: no output log"
+        failed=1
+        continue
+    fi
+    if [ "$1" == "--update" ]; then
+        cp "$log" "$golden"
+        echo "UPDATED $case"
+    elif diff -u "$golden" "$log"; then
+        echo "PASS $case"
+    else
+        echo "FAIL $case"
+        failed=1
+    fi
+    rm -f "$log"
+done
+
+# A trace converted with trace_convert --compressed must replay exactly like
+# the text trace it came from
+if [ "$1" != "--update" ]; then
+    case="MESI bodytrack 4096 2 32"
+    name=$(echo "$case" | tr ' ' '_')
+    repo=$(pwd)
+    tmp=$(mktemp -d)
+    mkdir -p "$tmp/bodytrack_four" "$tmp/results"
+    make -s tools > /dev/null || exit 1
+    for trace in bodytrack_four/*.data; do
+        ./trace_convert --compressed "$trace" "$tmp/$trace" > /dev/null || failed=1
+    done
+    log=$(cd "$tmp" && "$repo/coherence" $case --quantum=1000 --threads=1 | sed -n 's/^DONE: The output summary can be found at \(.*\)$/\1/p')
+    if [ -n "$log" ] && diff -u "regression/golden/$name.log" "$tmp/$log"; then
+        echo "PASS $case (compressed trace)"
+    else
+        echo "FAIL $case (compressed trace)"
+        failed=1
+    fi
+    rm -rf "$tmp"
+fi
+exit $failed
@@ -11,7 +11,7 @@ for protocol in "${protocols[@]}"; do
         for cache_size in "${cache_sizes[@]}"; do
             for associativity in "${associativities[@]}"; do
                 for block_size in "${block_sizes[@]}"; do
-                    ./coherence "$protocol" "$benchmark" "$cache_size" "$associativity" "$block_size"
+                    ./coherence "$protocol" "$benchmark" "$cache_size" "$associativity" "$block_size" --cache
                 done
             done
         done
@@ -23,7 +23,7 @@ for protocol in "${protocols[@]}"; do
         for cache_size in "${cache_sizes[@]}"; do
             for block_size in "${block_sizes[@]}"; do
                 associativity=$((cache_size / block_size))
-                ./coherence "$protocol" "$benchmark" "$cache_size" "$associativity" "$block_size"
+                ./coherence "$protocol" "$benchmark" "$cache_size" "$associativity" "$block_size" --cache
             done
         done
     done
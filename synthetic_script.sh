@@ -0,0 +1,20 @@
+#!/bin/bash
+# Simulator throughput on synthetic workloads, scaling accesses and cores.
+# 10^9 accesses in total at the largest point; prints the engine's timing line.
+
+protocols=("MESI" "Dragon")
+patterns=("uniform" "producer-consumer" "migratory" "false-sharing")
+core_counts=(4 16 64 128)
+total_accesses=(1000000 100000000 1000000000)
+
+for protocol in "${protocols[@]}"; do
+    for pattern in "${patterns[@]}"; do
+        for cores in "${core_counts[@]}"; do
+            for total in "${total_accesses[@]}"; do
+                echo -n "$protocol $pattern cores=$cores accesses=$total: "
+                ./coherence "$protocol" synthetic 65536 4 64 --cores="$cores" --syn-pattern="$pattern" \
+                    --syn-accesses=$((total / cores)) --quantum=1000 | grep "^Simulated"
+            done
+        done
+    done
+done
@@ -0,0 +1,93 @@
+/**
+ * Events To JSON
+ * Converts a binary coherence event trace (--events) to the Chrome trace
+ * event format, which chrome://tracing and ui.perfetto.dev can open.
+ * Each event becomes a complete event on the track of the core whose cache
+ * changed, spanning the requester's stall.
+ * Usage: ./events_to_json <EVENTS> <OUTPUT.json>
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "../utils/config.h"
+#include "../utils/event_trace.h"
+
+const char* MESI_NAMES[] = {"M", "E", "S", "I"};
+const char* DRAGON_NAMES[] = {"Ed", "Sc", "Sm", "Md", "not_found"};
+
+std::string state_name(uint32_t protocol, int state)
+{
+    if (protocol == Protocol::MESI && state >= 0 && state < 4)
+        return MESI_NAMES[state];
+    if (protocol != Protocol::MESI && state >= 0 && state < 5)
+        return DRAGON_NAMES[state];
+    return std::to_string(state);
+}
+
+std::string bus_op_name(int bus_op)
+{
+    std::string name;
+    if (bus_op & BusOp::bus_rd)
+        name += "BusRd ";
+    if (bus_op & BusOp::bus_upd)
+        name += "BusUpd ";
+    if (bus_op & BusOp::write_back)
+        name += "WriteBack ";
+    if (bus_op & BusOp::eviction)
+        name += "Evict ";
+    if (name.empty())
+        return "none";
+    name.pop_back();
+    return name;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3)
+    {
+        std::cout << "Usage: ./events_to_json <EVENTS> <OUTPUT.json>" << std::endl;
+        return 1;
+    }
+
+    FILE *input = fopen(argv[1], "rb");
+    char magic[4];
+    uint32_t header[3];
+    if (input == nullptr || fread(magic, 1, 4, input) != 4 || memcmp(magic, EVENT_TRACE_MAGIC, 4) != 0
+        || fread(header, sizeof(uint32_t), 3, input) != 3 || header[0] != EVENT_TRACE_VERSION)
+    {
+        std::cout << "ERROR: " << argv[1] << " is not a coherence event trace." << std::endl;
+        return 1;
+    }
+    uint32_t num_cores = header[1];
+    uint32_t protocol = header[2];
+
+    FILE *output = fopen(argv[2], "w");
+    if (output == nullptr)
+    {
+        std::cout << "ERROR: Cannot open " << argv[2] << " for writing." << std::endl;
+        return 1;
+    }
+    // One simulated cycle is shown as one microsecond
+    fprintf(output, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (uint32_t core = 0; core < num_cores; ++core)
+        fprintf(output, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"Core %u\"}},\n", core, core);
+
+    CoherenceEvent event;
+    long count = 0;
+    while (fread(&event, sizeof(event), 1, input) == 1)
+    {
+        std::string transition = state_name(protocol, event.old_state) + " -> " + state_name(protocol, event.new_state);
+        fprintf(output, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%lld,\"dur\":%d,"
+                        "\"args\":{\"addr\":\"0x%llx\",\"requester\":%d}}",
+                count == 0 ? "" : ",\n", transition.c_str(), bus_op_name(event.bus_op).c_str(), event.core,
+                (long long)event.cycle, event.latency, (unsigned long long)event.addr, event.requester);
+        ++count;
+    }
+    fprintf(output, "\n]}\n");
+    fclose(output);
+    fclose(input);
+    std::cout << "Converted " << count << " events to " << argv[2] << std::endl;
+    return 0;
+}
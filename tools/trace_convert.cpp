@@ -0,0 +1,74 @@
+/**
+ * Trace Convert
+ * Converts a trace of any format open_trace understands into the binary
+ * trace format: "CCTB" followed by packed {uint8 label, int64 value} records,
+ * or with --compressed into the delta-encoded "CCTZ" format (CompressedTrace).
+ * Usage: ./trace_convert [--compressed] <INPUT> <OUTPUT>
+*/
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "../utils/trace.h"
+
+int main(int argc, char* argv[]) {
+    bool compressed = argc == 4 && std::string(argv[1]) == "--compressed";
+    if (argc != 3 && !compressed)
+    {
+        std::cout << "Usage: ./trace_convert [--compressed] <INPUT> <OUTPUT>" << std::endl;
+        return 1;
+    }
+    const char *input_path = argv[argc - 2];
+    const char *output_path = argv[argc - 1];
+
+    TraceSource *input = open_trace(input_path);
+    FILE *output = fopen(output_path, "wb");
+    if (output == nullptr)
+    {
+        std::cout << "ERROR: Cannot open " << output_path << " for writing." << std::endl;
+        return 1;
+    }
+
+    CompressedTraceWriter *writer = nullptr;
+    if (compressed)
+        writer = new CompressedTraceWriter(output);
+    else
+        fwrite(BINARY_TRACE_MAGIC, 1, sizeof(BINARY_TRACE_MAGIC), output);
+    TraceRecord record;
+    long count = 0;
+    while (input->next(record))
+    {
+        if (writer != nullptr)
+        {
+            if (!writer->write(record))
+            {
+                std::cout << "ERROR: Label " << record.label << " of record " << count << " does not fit the compressed format." << std::endl;
+                fclose(output);
+                return 1;
+            }
+        }
+        else
+        {
+            uint8_t label = record.label;
+            int64_t value = record.value;
+            fwrite(&label, 1, 1, output);
+            fwrite(&value, sizeof(value), 1, output);
+        }
+        ++count;
+    }
+    if (writer != nullptr)
+        writer->close();
+    long bytes = ftell(output);
+    fclose(output);
+
+    if (input->failed)
+    {
+        std::cout << "ERROR: " << input_path << " is unreadable or malformed after " << count << " records." << std::endl;
+        return 1;
+    }
+    std::cout << "Converted " << count << " records to " << output_path << " (" << bytes << " bytes)" << std::endl;
+    delete input;
+    delete writer;
+    return 0;
+}
@@ -2,20 +2,76 @@
 #include "processor.h"
 #include "lru_cache.h"
 
-void Bus::init_cores(Processor *p0, Processor *p1, Processor *p2, Processor *p3) 
+void Bus::init_cores(std::vector<Processor*> _cores)
 {
-    cores[0] = p0;
-    cores[1] = p1;
-    cores[2] = p2;
-    cores[3] = p3;
+    cores = _cores;
+    num_cores = cores.size();
+    snoop_order.assign(num_cores, {});
+    for (int pid = 0; pid < num_cores; ++pid)
+    {
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            for (int i = 0; i < num_cores; ++i)
+            {
+                bool local = numa == nullptr || numa->socket_of(i) == numa->socket_of(pid);
+                if (i != pid && local == (pass == 0))
+                    snoop_order[pid].push_back(i);
+            }
+        }
+    }
+}
+
+void Bus::init_cache(std::vector<LRUCache*> _caches)
+{
+    caches = _caches;
+}
+
+void Bus::init_memory(Memory* _memory)
+{
+    memory = _memory;
+}
+
+void Bus::init_events(EventTracer* _events)
+{
+    events = _events;
+}
+
+void Bus::init_numa(Numa* _numa)
+{
+    numa = _numa;
+}
+
+long Bus::block_address(int set_num, int tag)
+{
+    return ((long)tag * num_blocks + set_num) * block_size;
+}
+
+void Bus::trace_event(int pid, int core, int set_num, int tag, int old_state, int new_state, int bus_op, int latency)
+{
+    CoherenceEvent event = {};
+    event.cycle = cores[pid]->get_clock();
+    event.addr = block_address(set_num, tag);
+    event.latency = latency;
+    event.core = core;
+    event.requester = pid;
+    event.old_state = old_state;
+    event.new_state = new_state;
+    event.bus_op = bus_op;
+    events->record(pid, event);
+}
+
+int Bus::MemRd(int pid, int set_num, int tag)
+{
+    long addr = block_address(set_num, tag);
+    int cycles = memory->access(addr, cores[pid]->get_clock(), false);
+    return numa ? cycles + numa->memory(pid, addr) : cycles;
 }
 
-void Bus::init_cache(LRUCache *c0, LRUCache *c1, LRUCache *c2, LRUCache *c3) 
+int Bus::MemWr(int pid, int set_num, int tag, int requester)
 {
-    caches[0] = c0;
-    caches[1] = c1;
-    caches[2] = c2;
-    caches[3] = c3;
+    long addr = block_address(set_num, tag);
+    int cycles = memory->access(addr, cores[requester < 0 ? pid : requester]->get_clock(), true);
+    return numa ? cycles + numa->memory(pid, addr) : cycles;
 }
 
 /*
@@ -25,10 +81,13 @@ MESI Bus Protocol APIs
 */
 int MESI_Bus::BusRd(int pid, int set_num, int tag)
 {
-    std::lock_guard<std::mutex> guard(bus_lock);
-    for (int i = 0; i < NUM_CORES; ++i)
+    if (events)
+        events->pending[pid].bus_op |= BusOp::bus_rd;
+    bool looked_up = false;
+    for (int i : snoop_order[pid])
     {
-        if (i == pid) continue;
+        if (numa)
+            numa->leave_socket(pid, i, looked_up);
         int status = caches[i]->get_status(set_num, tag);
         if (status != MESI_status::I)
         {
@@ -36,32 +95,49 @@ int MESI_Bus::BusRd(int pid, int set_num, int tag)
             {
                 // M -> S, write back to memory
                 caches[i]->count_data_traffic += 1;
-                cores[i]->idle_cycle += 100;
+                cores[i]->idle_cycle += MemWr(i, set_num, tag, pid);
             }
             caches[i]->set_status(set_num, tag, MESI_status::S);
+            if (events && status != MESI_status::S)
+                trace_event(pid, i, set_num, tag, status, MESI_status::S, BusOp::bus_rd | (status == MESI_status::M ? BusOp::write_back : 0), 0);
+            if (numa)
+                numa->transfer(pid, i);
+            ++caches[pid]->count_found_elsewhere;
             return status;
         }
     }
     return MESI_status::I;
 }
 
-int MESI_Bus::BusUpd(int pid, int set_num, int tag)
+int MESI_Bus::BusUpd(int pid, int set_num, int tag, bool keep)
 {
-    std::lock_guard<std::mutex> guard(bus_lock);
+    if (events)
+        events->pending[pid].bus_op |= BusOp::bus_upd;
     int count_invalidations = 0;
-    for (int i = 0; i < NUM_CORES; ++i)
+    bool looked_up = false;
+    for (int i : snoop_order[pid])
     {
-        if (i == pid) continue;
+        caches[i]->clear_reservation(set_num, tag);
         int status = caches[i]->get_status(set_num, tag);
         if (status != MESI_status::I)
         {
             ++count_invalidations;
+            if (numa)
+            {
+                numa->leave_socket(pid, i, looked_up);
+                numa->snoop(pid, i);
+            }
             caches[i]->set_status(set_num, tag, MESI_status::I); // do i need to write back? no, the other cache has the most recent data
-            // Comment for optimization
-            if (!optimize && status == MESI_status::M)
-                cores[i]->idle_cycle += 100;
+            // Comment for optimization: the requester takes the dirty data unless it keeps no copy
+            bool write_back = (!optimize || !keep) && status == MESI_status::M;
+            if (write_back)
+                cores[i]->idle_cycle += MemWr(i, set_num, tag, pid);
+            if (events)
+                trace_event(pid, i, set_num, tag, status, MESI_status::I, BusOp::bus_upd | (write_back ? BusOp::write_back : 0), 0);
         }
     }
+    if (count_invalidations > 0)
+        ++caches[pid]->count_found_elsewhere;
     return count_invalidations;
 }
 
@@ -72,36 +148,85 @@ Dragon Bus Protocol APIs
 */
 int Dragon_Bus::BusRd(int pid, int set_num, int tag)
 {
-    std::lock_guard<std::mutex> guard(bus_lock);
-    for (int i = 0; i < NUM_CORES; ++i)
+    if (events)
+        events->pending[pid].bus_op |= BusOp::bus_rd;
+    bool looked_up = false;
+    for (int i : snoop_order[pid])
     {
-        if (i == pid) continue;
+        if (numa)
+            numa->leave_socket(pid, i, looked_up);
         int status = caches[i]->get_status(set_num, tag);
         if (status == Dragon_status::Md)
         {
             caches[i]->set_status(set_num, tag, Dragon_status::Sm);
+            if (events)
+                trace_event(pid, i, set_num, tag, status, Dragon_status::Sm, BusOp::bus_rd, 0);
+            if (numa)
+                numa->transfer(pid, i);
+            ++caches[pid]->count_found_elsewhere;
             return status;
         }
         else if (status == Dragon_status::Ed || status == Dragon_status::Sc)
         {
             caches[i]->set_status(set_num, tag, Dragon_status::Sc);
+            if (events && status != Dragon_status::Sc)
+                trace_event(pid, i, set_num, tag, status, Dragon_status::Sc, BusOp::bus_rd, 0);
+            if (numa)
+                numa->transfer(pid, i);
+            ++caches[pid]->count_found_elsewhere;
             return status;
         }
     }
     return Dragon_status::not_found;
 }
-int Dragon_Bus::BusUpd(int pid, int set_num, int tag)
+int Dragon_Bus::BusUpd(int pid, int set_num, int tag, bool keep)
 {
-    std::lock_guard<std::mutex> guard(bus_lock);
+    if (events)
+        events->pending[pid].bus_op |= BusOp::bus_upd;
     int count_updates = 0;
-    for (int i = 0; i < NUM_CORES; ++i)
+    bool looked_up = false;
+    for (int i : snoop_order[pid])
     {
-        if (i == pid) continue;
-        if (caches[i]->get_status(set_num, tag) != Dragon_status::not_found)
+        caches[i]->clear_reservation(set_num, tag);
+        int status = caches[i]->get_status(set_num, tag);
+        if (status != Dragon_status::not_found)
         {
             ++count_updates;
+            if (numa)
+            {
+                numa->leave_socket(pid, i, looked_up);
+                numa->snoop(pid, i);
+            }
             caches[i]->set_status(set_num, tag, Dragon_status::Sc); // do i need to write back? no, the other cache has the most recent data
+            // ...unless the requester keeps no copy to take over the ownership
+            bool write_back = !keep && (status == Dragon_status::Md || status == Dragon_status::Sm);
+            if (write_back)
+            {
+                caches[i]->count_data_traffic += 1;
+                cores[i]->idle_cycle += MemWr(i, set_num, tag, pid);
+            }
+            if (events)
+                trace_event(pid, i, set_num, tag, status, Dragon_status::Sc, BusOp::bus_upd | (write_back ? BusOp::write_back : 0), 0);
         }
     }
+    if (count_updates > 0)
+        ++caches[pid]->count_found_elsewhere;
     return count_updates;
-}
\ No newline at end of file
+}
+
+/*
+****************************************************
+Hybrid Bus Protocol APIs
+****************************************************
+*/
+int Hybrid_Bus::BusUpd(int pid, int set_num, int tag, bool keep)
+{
+    // The update is broadcast as in Dragon, then stale copies drop out
+    int count_updates = Dragon_Bus::BusUpd(pid, set_num, tag, keep);
+    for (int i : snoop_order[pid])
+    {
+        if (caches[i]->unused_update(set_num, tag, threshold) && events)
+            trace_event(pid, i, set_num, tag, Dragon_status::Sc, Dragon_status::not_found, BusOp::bus_upd, 0);
+    }
+    return count_updates;
+}
@@ -1,26 +1,32 @@
 #ifndef _BUS_H
 #define _BUS_H
 
-#include <mutex>
 #include <vector>
 
 #include "global_lock.h"
 #include "config.h"
+#include "event_trace.h"
+#include "memory.h"
+#include "numa.h"
 
 class Processor;
 class LRUCache;
 
 class Bus {
 public:
-    const int NUM_CORES = 4;
+    int num_cores = 0;
     int num_blocks;
     int associativity;
     int block_size;
     bool optimize;
     GlobalLock *gl;
-    std::vector<Processor*> cores = std::vector<Processor*>(4);
-    std::vector<LRUCache*> caches = std::vector<LRUCache*>(4);
-    std::mutex bus_lock;
+    Memory *memory = nullptr;
+    EventTracer *events = nullptr;
+    Numa *numa = nullptr;
+    std::vector<Processor*> cores;
+    std::vector<LRUCache*> caches;
+    // Other cores in the order pid snoops them, its own socket first
+    std::vector<std::vector<int>> snoop_order;
 
     Bus(int _cache_size, int _associativity, int _block_size, bool _optimize, GlobalLock* _gl)
     : num_blocks((_cache_size/_block_size)/_associativity)
@@ -30,14 +36,33 @@ public:
     , gl(_gl)
     {}
 
-    void init_cores(Processor* p0, Processor* p1, Processor* p2, Processor* p3);
-    void init_cache(LRUCache* c0, LRUCache* c1, LRUCache* c2, LRUCache* c3);
+    void init_cores(std::vector<Processor*> _cores);
+    void init_cache(std::vector<LRUCache*> _caches);
+    void init_memory(Memory* _memory);
+    void init_events(EventTracer* _events);
+    // Before init_cores, which orders the snoops by socket
+    void init_numa(Numa* _numa);
 
+    long block_address(int set_num, int tag);
+    // Records a state change of core's copy caused by pid, only when tracing
+    void trace_event(int pid, int core, int set_num, int tag, int old_state, int new_state, int bus_op, int latency);
+
+    // Block fetch from and write-back to memory on behalf of core pid,
+    // returning the cycles that core stalls. A write-back that a snoop forces
+    // on core pid is issued at the clock of the requester, the only core whose
+    // clock the calling thread may read
+    int MemRd(int pid, int set_num, int tag);
+    int MemWr(int pid, int set_num, int tag, int requester = -1);
+
+    // Callers must hold the GlobalLock of set_num, which serializes
+    // bus transactions for every address mapping to that set.
     // Although this is not best practice,
-    // child classes don't have additional data
+    // child classes only add trivially destructible data
     // hence a virtual destructor is not needed
     virtual int BusRd(int pid, int set_num, int tag) = 0;
-    virtual int BusUpd(int pid, int set_num, int tag) = 0;
+    // keep is false when the requester writes without keeping a copy, then a
+    // dirty copy that loses its owner state is written back first
+    virtual int BusUpd(int pid, int set_num, int tag, bool keep = true) = 0;
 };
 
 class MESI_Bus : public Bus {
@@ -46,7 +71,7 @@ public:
     : Bus(_cache_size, _associativity, _block_size, _optimize, _gl)
     {}
     int BusRd(int pid, int set_num, int tag);
-    int BusUpd(int pid, int set_num, int tag);
+    int BusUpd(int pid, int set_num, int tag, bool keep = true);
 };
 
 class Dragon_Bus : public Bus {
@@ -55,7 +80,26 @@ public:
     : Bus(_cache_size, _associativity, _block_size, _optimize, _gl)
     {}
     int BusRd(int pid, int set_num, int tag);
-    int BusUpd(int pid, int set_num, int tag);
+    int BusUpd(int pid, int set_num, int tag, bool keep = true);
+};
+
+/**
+ * Hybrid Bus
+ * Dragon with competitive self-invalidation: every copy counts the updates it
+ * receives without a local access in between, and drops out of the sharing
+ * set once `threshold` of them pile up. Blocks the other cores keep reading
+ * stay in update mode, blocks they stopped using fall back to invalidation
+ * and the writer moves to Md as soon as it is the last sharer.
+*/
+class Hybrid_Bus : public Dragon_Bus {
+public:
+    int threshold;
+
+    Hybrid_Bus(int _cache_size, int _associativity, int _block_size, bool _optimize, GlobalLock* _gl, int _threshold)
+    : Dragon_Bus(_cache_size, _associativity, _block_size, _optimize, _gl)
+    , threshold(_threshold)
+    {}
+    int BusUpd(int pid, int set_num, int tag, bool keep = true);
 };
 
 #endif // _BUS_H
\ No newline at end of file
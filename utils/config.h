@@ -1,9 +1,15 @@
 #ifndef _CONFIG_H
 #define _CONFIG_H
 
-enum Protocol {MESI, Dragon};
-enum Benchmark {blackscholes, bodytrack, fluidanimate};
+enum Protocol {MESI, Dragon, Hybrid};
+enum Benchmark {blackscholes, bodytrack, fluidanimate, synthetic, manifest};
 enum MESI_status {M, E, S, I};
 enum Dragon_status {Ed, Sc, Sm, Md, not_found};
+enum PagePolicy {sequential, randomized, coloring};
+enum SchedulingPolicy {fcfs, frfcfs};
+enum BusOp {no_bus_op = 0, bus_rd = 1, bus_upd = 2, write_back = 4, eviction = 8};
+enum SchedulingMode {one_per_core, pinned, round_robin, affinity};
+enum NumaPolicy {first_touch, interleave};
+enum SyntheticPattern {uniform, producer_consumer, migratory, false_sharing};
 
 #endif // _CONFIG_H
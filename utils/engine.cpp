@@ -0,0 +1,126 @@
+#include "engine.h"
+#include "processor.h"
+
+#include <algorithm>
+#include <barrier>
+#include <thread>
+
+Engine::Engine(std::vector<Processor*> _cores, long _quantum, int _threads)
+: cores(_cores)
+, quantum(_quantum)
+, num_threads(_threads)
+{
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (num_threads > (int)cores.size())
+        num_threads = cores.size();
+}
+
+void Engine::run()
+{
+    if (quantum == 0)
+        run_free();
+    else
+        run_quantum();
+}
+
+void Engine::run_free()
+{
+    std::vector<std::thread> threads;
+    for (Processor *core : cores)
+        threads.emplace_back(&Processor::run, core);
+    for (std::thread &t : threads)
+        t.join();
+}
+
+namespace {
+
+struct ClockEntry {
+    long clock;
+    int pos; // position in the group, breaks ties like the original scan did
+};
+
+bool earlier(const ClockEntry& a, const ClockEntry& b)
+{
+    return a.clock < b.clock || (a.clock == b.clock && a.pos < b.pos);
+}
+
+// Moves the top entry down to its place after its key grew
+void sift_down(std::vector<ClockEntry>& heap)
+{
+    size_t n = heap.size();
+    size_t i = 0;
+    while (true)
+    {
+        size_t first = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        if (left < n && earlier(heap[left], heap[first]))
+            first = left;
+        if (right < n && earlier(heap[right], heap[first]))
+            first = right;
+        if (first == i)
+            return;
+        std::swap(heap[i], heap[first]);
+        i = first;
+    }
+}
+
+}
+
+void Engine::run_quantum()
+{
+    std::vector<std::vector<Processor*>> groups(num_threads);
+    for (size_t i = 0; i < cores.size(); ++i)
+        groups[i % num_threads].push_back(cores[i]);
+
+    // Only written by the barrier's completion step, while every thread is blocked
+    long window_end = quantum;
+    std::barrier sync(num_threads, [&]() noexcept { window_end += quantum; });
+
+    auto worker = [&](std::vector<Processor*> group) {
+        // Min-heap of the group's cores by (clock, position), the core furthest
+        // behind on top. Snoops of other cores only push a clock forward, so a
+        // stale key is never above the core's clock and is refreshed when it
+        // reaches the top
+        std::vector<ClockEntry> heap;
+        for (size_t i = 0; i < group.size(); ++i)
+            heap.push_back({group[i]->get_clock(), (int)i});
+        std::sort(heap.begin(), heap.end(), earlier);
+
+        while (!heap.empty())
+        {
+            long end = window_end;
+            while (!heap.empty() && heap[0].clock < end)
+            {
+                Processor *core = group[heap[0].pos];
+                long clock = core->get_clock();
+                if (clock == heap[0].clock)
+                {
+                    if (!core->step())
+                    {
+                        heap[0] = heap.back();
+                        heap.pop_back();
+                        sift_down(heap);
+                        continue;
+                    }
+                    clock = core->get_clock();
+                }
+                heap[0].clock = clock;
+                sift_down(heap);
+            }
+
+            if (heap.empty())
+                sync.arrive_and_drop();
+            else
+                sync.arrive_and_wait();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; ++i)
+        threads.emplace_back(worker, groups[i]);
+    worker(groups[0]);
+    for (std::thread &t : threads)
+        t.join();
+}
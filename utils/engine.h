@@ -0,0 +1,35 @@
+#ifndef _ENGINE_H
+#define _ENGINE_H
+
+/**
+ * Engine
+ * Drives the cores' traces on host threads.
+ * - quantum == 0: every core runs freely on its own thread, as the original
+ *   simulator did, so the cores' positions in simulated time drift apart.
+ * - quantum > 0: conservative parallel simulation. Cores are split into groups,
+ *   one host thread per group. Within a window of `quantum` simulated cycles a
+ *   thread advances its cores in simulated time order, and no core starts an
+ *   access past the end of the window until every thread has reached the
+ *   barrier. A single host thread therefore gives a fully deterministic run,
+ *   and with more threads cross-core reordering is bounded by one quantum.
+*/
+
+#include <vector>
+
+class Processor;
+
+class Engine {
+public:
+    std::vector<Processor*> cores;
+    long quantum;
+    int num_threads;
+
+    Engine(std::vector<Processor*> _cores, long _quantum, int _threads);
+    void run();
+
+private:
+    void run_free();
+    void run_quantum();
+};
+
+#endif // _ENGINE_H
@@ -0,0 +1,84 @@
+#include "event_trace.h"
+
+#include <chrono>
+#include <iostream>
+
+EventTracer::EventTracer(const std::string& path, int num_cores, Protocol protocol)
+: rings(num_cores)
+, file(fopen(path.c_str(), "wb"))
+, pending(num_cores)
+{
+    if (file == nullptr)
+    {
+        std::cout << "ERROR: Cannot open event trace " << path << "." << std::endl;
+        return;
+    }
+    for (EventRing &ring : rings)
+    {
+        ring.buffer.resize(RING_SIZE);
+        ring.mask = RING_SIZE - 1;
+    }
+    uint32_t header[3] = {EVENT_TRACE_VERSION, (uint32_t)num_cores, (uint32_t)protocol};
+    fwrite(EVENT_TRACE_MAGIC, 1, sizeof(EVENT_TRACE_MAGIC), file);
+    fwrite(header, sizeof(uint32_t), 3, file);
+    flusher = std::thread(&EventTracer::flush_loop, this);
+}
+
+void EventTracer::record(int ring_index, const CoherenceEvent& event)
+{
+    EventRing &ring = rings[ring_index];
+    size_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= RING_SIZE)
+    {
+        // Full: wake the flusher and wait for room rather than drop events
+        flusher_wakeup.notify_one();
+        while (head - ring.tail.load(std::memory_order_acquire) >= RING_SIZE)
+            std::this_thread::yield();
+    }
+    ring.buffer[head & ring.mask] = event;
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void EventTracer::flush()
+{
+    for (EventRing &ring : rings)
+    {
+        size_t tail = ring.tail.load(std::memory_order_relaxed);
+        size_t head = ring.head.load(std::memory_order_acquire);
+        if (head == tail)
+            continue;
+        // At most two contiguous runs, split where the ring wraps around
+        size_t begin = tail & ring.mask;
+        size_t count = head - tail;
+        size_t first = std::min(count, RING_SIZE - begin);
+        fwrite(&ring.buffer[begin], sizeof(CoherenceEvent), first, file);
+        fwrite(&ring.buffer[0], sizeof(CoherenceEvent), count - first, file);
+        count_events += count;
+        ring.tail.store(head, std::memory_order_release);
+    }
+}
+
+void EventTracer::flush_loop()
+{
+    std::unique_lock<std::mutex> guard(flusher_lock);
+    while (!stopping)
+    {
+        flusher_wakeup.wait_for(guard, std::chrono::milliseconds(1));
+        flush();
+    }
+    flush();
+}
+
+void EventTracer::stop()
+{
+    if (file == nullptr)
+        return;
+    {
+        std::lock_guard<std::mutex> guard(flusher_lock);
+        stopping = true;
+    }
+    flusher_wakeup.notify_one();
+    flusher.join();
+    fclose(file);
+    file = nullptr;
+}
@@ -0,0 +1,86 @@
+#ifndef _EVENT_TRACE_H
+#define _EVENT_TRACE_H
+
+/**
+ * Coherence Event Trace
+ * Opt-in record of every cache state transition: the requesting core's own
+ * transition on each access, transitions the bus causes in other caches, and
+ * evictions. Each core has a single-producer single-consumer lock-free ring
+ * buffer, filled by the host thread running that core and drained by one
+ * flusher thread into a binary file:
+ *   header: "CCEV", uint32 version, uint32 number of cores, uint32 protocol
+ *   records: CoherenceEvent, 32 bytes each, in flush order
+ * tools/events_to_json converts the file to Chrome trace / Perfetto JSON.
+ * When tracing is off the simulator only tests a null pointer.
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+
+const char EVENT_TRACE_MAGIC[4] = {'C', 'C', 'E', 'V'};
+const uint32_t EVENT_TRACE_VERSION = 1;
+
+struct CoherenceEvent {
+    int64_t cycle;     // requester's clock
+    int64_t addr;      // block address
+    int32_t latency;   // cycles the requester stalled, 0 for snooped caches
+    int16_t core;      // cache whose state changed
+    int16_t requester; // core whose access caused it
+    uint8_t old_state;
+    uint8_t new_state;
+    uint8_t bus_op;    // BusOp bits
+    uint8_t reserved[5];
+};
+static_assert(sizeof(CoherenceEvent) == 32, "CoherenceEvent must stay 32 bytes");
+
+struct alignas(64) EventRing {
+    std::vector<CoherenceEvent> buffer;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head = 0; // next slot the producer writes
+    alignas(64) std::atomic<size_t> tail = 0; // next slot the flusher reads
+};
+
+// The access a core is executing, filled in while it holds the set lock
+struct PendingAccess {
+    uint8_t bus_op = BusOp::no_bus_op; // BusOp bits issued
+    bool started = false;              // old_state has been captured
+    uint8_t old_state = 0;             // requester's own transition
+    uint8_t new_state = 0;
+};
+
+class EventTracer {
+private:
+    static const size_t RING_SIZE = 1 << 14;
+
+    std::vector<EventRing> rings;
+    FILE *file;
+    std::thread flusher;
+    std::mutex flusher_lock;
+    std::condition_variable flusher_wakeup;
+    bool stopping = false;
+
+    void flush();
+    void flush_loop();
+
+public:
+    // Current access of each core
+    std::vector<PendingAccess> pending;
+    long count_events = 0;
+
+    EventTracer(const std::string& path, int num_cores, Protocol protocol);
+    bool is_open() { return file != nullptr; }
+    // Drains every ring and closes the file
+    void stop();
+    // Called by the host thread currently running core `ring`
+    void record(int ring, const CoherenceEvent& event);
+};
+
+#endif // _EVENT_TRACE_H
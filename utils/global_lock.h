@@ -3,25 +3,68 @@
 
 /**
  * Global Lock
- * A global lock is needed for each set to avoid race conditions when accessing 
+ * A global lock is needed for each set to avoid race conditions when accessing
  * same or different memory at addresses with the same block number.
  * This preserves the total program order for accesses to these memory addresses.
+ *
+ * Every bus transaction for an address only touches that address' set in each
+ * cache, so the set lock held by the requesting core also serializes the bus
+ * per address. There is no separate global bus lock.
 */
 
+#include <atomic>
 #include <iostream>
-#include <mutex>
 #include <vector>
 
+/**
+ * Set Lock
+ * Spin-then-park lock padded to its own cache line so that neighbouring sets
+ * do not false-share. A waiter spins briefly on a read-only load and then
+ * parks on the flag with std::atomic::wait until the holder releases it.
+*/
+class alignas(64) SetLock {
+private:
+    static const int SPIN_LIMIT = 128;
+    std::atomic<bool> locked = false;
+
+public:
+    // Statistics, only written by the current holder
+    long acquisitions = 0;
+    long contended = 0;
+
+    void lock()
+    {
+        bool waited = false;
+        while (locked.exchange(true, std::memory_order_acquire))
+        {
+            waited = true;
+            for (int spins = 0; locked.load(std::memory_order_relaxed); ++spins)
+            {
+                if (spins >= SPIN_LIMIT)
+                    locked.wait(true, std::memory_order_relaxed);
+            }
+        }
+        ++acquisitions;
+        if (waited)
+            ++contended;
+    }
+
+    void unlock()
+    {
+        locked.store(false, std::memory_order_release);
+        locked.notify_one();
+    }
+};
+
 class GlobalLock {
 public:
     int num_blocks;
-    std::vector<std::mutex> mutexes;
+    std::vector<SetLock> mutexes;
 
     GlobalLock(int cache_size, int associativity, int block_size)
-    {
-        this->num_blocks = (cache_size / block_size) / associativity;
-        mutexes = std::vector<std::mutex>(this->num_blocks);
-    }
+    : num_blocks((cache_size / block_size) / associativity)
+    , mutexes(num_blocks)
+    {}
 
     void lockIdx(int idx)
     {
@@ -38,6 +81,34 @@ public:
         else
             mutexes[idx].unlock();
     }
+
+    long get_acquisitions()
+    {
+        long sum = 0;
+        for (SetLock &m : mutexes)
+            sum += m.acquisitions;
+        return sum;
+    }
+
+    long get_contended()
+    {
+        long sum = 0;
+        for (SetLock &m : mutexes)
+            sum += m.contended;
+        return sum;
+    }
+
+    // Returns the set whose lock was contended the most
+    int get_hottest_set()
+    {
+        int hottest = 0;
+        for (int i = 1; i < num_blocks; ++i)
+        {
+            if (mutexes[i].contended > mutexes[hottest].contended)
+                hottest = i;
+        }
+        return hottest;
+    }
 };
 
-#endif // _GLOBAL_LOCK_H
\ No newline at end of file
+#endif // _GLOBAL_LOCK_H
@@ -0,0 +1,56 @@
+#ifndef _INTERVAL_STATS_H
+#define _INTERVAL_STATS_H
+
+/**
+ * Interval Statistics
+ * Samples a core's cumulative counters every `interval_accesses` memory
+ * accesses or every `interval_cycles` simulated cycles, whichever comes first,
+ * so that program phases can be told apart. A disabled interval is 0.
+ * Samples are kept in memory and written out once at the end of the run.
+*/
+
+#include <climits>
+#include <vector>
+
+struct IntervalSample {
+    long cycle;
+    long accesses;
+    long misses;
+    long bus_traffic;
+    long updates;
+    long idle;
+};
+
+class IntervalRecorder {
+private:
+    long next_accesses;
+    long next_cycle;
+
+public:
+    long interval_accesses;
+    long interval_cycles;
+    std::vector<IntervalSample> samples;
+
+    IntervalRecorder(long _interval_accesses, long _interval_cycles)
+    : next_accesses(_interval_accesses > 0 ? _interval_accesses : LONG_MAX)
+    , next_cycle(_interval_cycles > 0 ? _interval_cycles : LONG_MAX)
+    , interval_accesses(_interval_accesses)
+    , interval_cycles(_interval_cycles)
+    {}
+
+    bool due(long accesses, long cycle)
+    {
+        return accesses >= next_accesses || cycle >= next_cycle;
+    }
+
+    void record(const IntervalSample& sample)
+    {
+        samples.push_back(sample);
+        while (interval_accesses > 0 && next_accesses <= sample.accesses)
+            next_accesses += interval_accesses;
+        while (interval_cycles > 0 && next_cycle <= sample.cycle)
+            next_cycle += interval_cycles;
+    }
+};
+
+#endif // _INTERVAL_STATS_H
@@ -0,0 +1,140 @@
+#include "latency.h"
+
+#include <fstream>
+#include <iostream>
+
+bool LatencyConfig::set(Latency& latency, const std::string& key, int value)
+{
+    if (key == "hit")
+        latency.hit = value;
+    else if (key == "word-transfer")
+        latency.word_transfer = value;
+    else if (key == "invalidation")
+        latency.invalidation = value;
+    else if (key == "memory")
+        latency.memory = value;
+    else if (key == "word-size" || key == "bus-width")
+        latency.word_size = value;
+    else if (key == "dram-cas")
+        latency.dram_cas = value;
+    else if (key == "dram-rcd")
+        latency.dram_rcd = value;
+    else if (key == "dram-rp")
+        latency.dram_rp = value;
+    else if (key == "dram-burst")
+        latency.dram_burst = value;
+    else if (key == "remote-memory")
+        latency.remote_memory = value;
+    else if (key == "remote-transfer")
+        latency.remote_transfer = value;
+    else if (key == "remote-snoop")
+        latency.remote_snoop = value;
+    else if (key == "remote-directory")
+        latency.remote_directory = value;
+    else if (key == "victim")
+        latency.victim = value;
+    else
+        return false;
+    return true;
+}
+
+bool LatencyConfig::load(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR: Cannot open latency file " << path << "." << std::endl;
+        return false;
+    }
+    std::string line;
+    for (int line_num = 1; std::getline(file, line); ++line_num)
+    {
+        line = line.substr(0, line.find('#'));
+        size_t eq = line.find('=');
+        std::string key = line.substr(0, eq);
+        key.erase(0, key.find_first_not_of(" \t\r"));
+        key.erase(key.find_last_not_of(" \t\r") + 1);
+        if (key.empty() && eq == std::string::npos)
+            continue;
+
+        bool valid = eq != std::string::npos;
+        int value = 0;
+        try
+        {
+            if (valid)
+                value = std::stoi(line.substr(eq + 1));
+        }
+        catch (const std::exception&)
+        {
+            valid = false;
+        }
+
+        int core = -1;
+        if (valid && key.rfind("core.", 0) == 0)
+        {
+            size_t dot = key.find('.', 5);
+            try
+            {
+                core = dot == std::string::npos ? -1 : std::stoi(key.substr(5, dot - 5));
+            }
+            catch (const std::exception&)
+            {
+                core = -1;
+            }
+            key = dot == std::string::npos ? "" : key.substr(dot + 1);
+            // The memory, the bus and the socket interconnect are shared, so their parameters cannot differ per core
+            valid = core >= 0 && key != "memory" && key != "word-size" && key != "bus-width"
+                && key.rfind("dram-", 0) != 0 && key.rfind("remote-", 0) != 0;
+        }
+
+        Latency check;
+        if (valid)
+            valid = value >= 0 && set(check, key, value) && check.word_size > 0;
+        if (!valid)
+        {
+            std::cout << "ERROR: Malformed line " << line_num << " of latency file " << path << ": " << line << std::endl;
+            return false;
+        }
+        if (core >= 0)
+            overrides[core][key] = value;
+        else
+            set(defaults, key, value);
+    }
+    return true;
+}
+
+Latency LatencyConfig::for_core(int pid) const
+{
+    Latency latency = defaults;
+    auto it = overrides.find(pid);
+    if (it != overrides.end())
+    {
+        for (const auto& [key, value] : it->second)
+            set(latency, key, value);
+    }
+    return latency;
+}
+
+std::string LatencyConfig::describe() const
+{
+    std::string s = "hit=" + std::to_string(defaults.hit) + ";";
+    s += "word-transfer=" + std::to_string(defaults.word_transfer) + ";";
+    s += "invalidation=" + std::to_string(defaults.invalidation) + ";";
+    s += "memory=" + std::to_string(defaults.memory) + ";";
+    s += "word-size=" + std::to_string(defaults.word_size) + ";";
+    s += "dram-cas=" + std::to_string(defaults.dram_cas) + ";";
+    s += "dram-rcd=" + std::to_string(defaults.dram_rcd) + ";";
+    s += "dram-rp=" + std::to_string(defaults.dram_rp) + ";";
+    s += "dram-burst=" + std::to_string(defaults.dram_burst) + ";";
+    s += "remote-memory=" + std::to_string(defaults.remote_memory) + ";";
+    s += "remote-transfer=" + std::to_string(defaults.remote_transfer) + ";";
+    s += "remote-snoop=" + std::to_string(defaults.remote_snoop) + ";";
+    s += "remote-directory=" + std::to_string(defaults.remote_directory) + ";";
+    s += "victim=" + std::to_string(defaults.victim) + ";";
+    for (const auto& [core, keys] : overrides)
+    {
+        for (const auto& [key, value] : keys)
+            s += "core." + std::to_string(core) + "." + key + "=" + std::to_string(value) + ";";
+    }
+    return s;
+}
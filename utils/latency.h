@@ -0,0 +1,58 @@
+#ifndef _LATENCY_H
+#define _LATENCY_H
+
+/**
+ * Latency Configuration
+ * Timing parameters of the caches and the bus, defaulting to the textbook
+ * constants the simulator was written with. A --latency file overrides them
+ * with "key = value" lines; "core.<n>.<key> = value" overrides a key for core
+ * n only, to model heterogeneous clusters. '#' starts a comment.
+ * Keys: hit, word-transfer, invalidation, victim and, shared by every core,
+ * memory (flat memory only), word-size (bus width in bytes), the DRAM
+ * timings dram-cas, dram-rcd, dram-rp and dram-burst (--memory=dram only)
+ * and the extra cycles of crossing sockets: remote-memory, remote-transfer,
+ * remote-snoop and remote-directory.
+*/
+
+#include <map>
+#include <string>
+#include <vector>
+
+struct Latency {
+    int hit = 1;            // cycles of a cache hit
+    int word_transfer = 2;  // cycles per bus word sent between caches
+    int invalidation = 2;   // cycles per invalidated copy
+    int victim = 1;         // extra cycles of swapping a line back from the victim cache
+    int memory = 100;       // cycles of a flat memory access or write-back
+    int word_size = 4;      // bytes per bus word
+    int dram_cas = 30;      // DRAM column access
+    int dram_rcd = 30;      // DRAM row activation
+    int dram_rp = 30;       // DRAM precharge
+    int dram_burst = 10;    // DRAM data transfer of one block
+    int remote_memory = 60;   // extra cycles of a memory access to another socket
+    int remote_transfer = 40; // extra cycles of a block sent from another socket
+    int remote_snoop = 40;    // extra cycles per invalidation or update of another socket
+    int remote_directory = 20; // home agent lookup of a request leaving its socket
+
+    // Cycles to send `bytes` over the bus between caches
+    int transfer(int bytes) const { return word_transfer * (bytes / word_size); }
+};
+
+class LatencyConfig {
+private:
+    // Per-core overrides, key -> value
+    std::map<int, std::map<std::string, int>> overrides;
+
+    static bool set(Latency& latency, const std::string& key, int value);
+
+public:
+    Latency defaults;
+
+    // Returns false and prints the offending line if the file is unreadable or malformed
+    bool load(const std::string& path);
+    Latency for_core(int pid) const;
+    // Canonical key=value list, used to key the results cache
+    std::string describe() const;
+};
+
+#endif // _LATENCY_H
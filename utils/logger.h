@@ -5,42 +5,51 @@
 #include <string>
 #include <unistd.h>
 
+#include "bus.h"
+#include "global_lock.h"
 #include "processor.h"
 
 class Logger {
 private:
     std::ofstream output_log;
-    std::vector<Processor*> cores = std::vector<Processor*>(4);
-    std::vector<LRUCache*> caches = std::vector<LRUCache*>(4);
+    std::vector<Processor*> cores;
+    std::vector<LRUCache*> caches;
+    Bus *bus;
+    GlobalLock *gl;
     std::string output_path = "results/";
     long avg_overall = 0;
     long avg_idle = 0;
     double avg_miss = 0;
-    int updates = 0;
-    const int NUM_CORES = 4;
+    long updates = 0;
+    const int NUM_CORES;
     int block_size;
 public:
-    Logger(Processor* core0, Processor* core1, Processor* core2, Processor* core3, std::string arguments, int _block_size)
-    : block_size(_block_size)
+    Logger(std::vector<Processor*> _cores, Bus* _bus, std::string arguments, int _block_size, std::string cache_key = "")
+    : cores(_cores)
+    , bus(_bus)
+    , gl(_bus->gl)
+    , NUM_CORES(_cores.size())
+    , block_size(_block_size)
     {
-        cores[0] = core0;
-        cores[1] = core1;
-        cores[2] = core2;
-        cores[3] = core3;
-
-        caches[0] = core0->get_cache();
-        caches[1] = core1->get_cache();
-        caches[2] = core2->get_cache();
-        caches[3] = core3->get_cache();
+        for (Processor *core : cores)
+            caches.push_back(core->get_cache());
 
         output_path += arguments;
-        int index = 1;
-        while(!access((output_path + "_" + std::to_string(index) + ".log").c_str(), F_OK))
+        if (!cache_key.empty())
         {
-            ++index;
+            // Cached runs have a stable name and overwrite stale or partial logs
+            output_path = output_path + "_" + cache_key + ".log";
         }
+        else
+        {
+            int index = 1;
+            while(!access((output_path + "_" + std::to_string(index) + ".log").c_str(), F_OK))
+            {
+                ++index;
+            }
 
-        output_path = output_path + "_" + std::to_string(index) + ".log";
+            output_path = output_path + "_" + std::to_string(index) + ".log";
+        }
         output_log.open(output_path, std::ios::out);
 
         output_log << "Input: " << arguments << std::endl;
@@ -62,7 +71,7 @@ public:
         output_log << "------------------------------" << std::endl;
         output_log << "2. Number of compute cycles per core" << std::endl;
         for (int i = 0; i < NUM_CORES; i++) {
-            int curr_val = cores[i]->get_compute_cycle();
+            long curr_val = cores[i]->get_compute_cycle();
             output_log << "Core " << i << ": " << curr_val << std::endl;
         }
     }
@@ -71,7 +80,7 @@ public:
         output_log << "------------------------------" << std::endl;
         output_log << "3. Number of load/store instructions per core" << std::endl;
         for (int i = 0; i < NUM_CORES; i++) {
-            int curr_val = cores[i]->get_count_mem_instr();
+            long curr_val = cores[i]->get_count_mem_instr();
             output_log << "Core " << i << ": " << curr_val << std::endl;
         }
     }
@@ -80,7 +89,7 @@ public:
         output_log << "------------------------------" << std::endl;
         output_log << "4. Number of idle cycles per core" << std::endl;
         for (int i = 0; i < NUM_CORES; i++) {
-            int curr_val = cores[i]->get_idle_cycle();
+            long curr_val = cores[i]->get_idle_cycle();
             avg_idle += curr_val/NUM_CORES;
             output_log << "Core " << i << ": " << curr_val << std::endl;
         }
@@ -90,8 +99,8 @@ public:
         output_log << "------------------------------" << std::endl;
         output_log << "5. Data cache miss rate for each core" << std::endl;
         for (int i = 0; i < NUM_CORES; i++) {
-            int num_miss = cores[i]->get_count_cache_miss();
-            int num_instr = cores[i]->get_count_mem_instr();
+            long num_miss = cores[i]->get_count_cache_miss();
+            long num_instr = cores[i]->get_count_mem_instr();
             double miss_rate = double(num_miss)/double(num_instr);
             avg_miss += miss_rate/NUM_CORES;
             output_log << "Core " << i << ": " << miss_rate << std::endl;
@@ -101,7 +110,7 @@ public:
     void print_amt_of_data_traffic() {
         output_log << "------------------------------" << std::endl;
         output_log << "6. Amount of Data traffic in bytes on the bus" << std::endl;
-        int sum_traffic = 0;
+        long sum_traffic = 0;
         for (int i = 0; i < NUM_CORES; i++) {
             sum_traffic += cores[i]->get_count_data_traffic();
         }
@@ -112,7 +121,7 @@ public:
     void print_count_update() {
         output_log << "------------------------------" << std::endl;
         output_log << "7. Number of invalidations or updates on the bus" << std::endl;
-        int sum_update = 0;
+        long sum_update = 0;
         for (int i = 0; i < NUM_CORES; i++) {
             sum_update += cores[i]->get_count_update();
         }
@@ -124,14 +133,206 @@ public:
         output_log << "------------------------------" << std::endl;
         output_log << "8. Distribution of accesses to private data versus shared data" << std::endl;
         for (int i = 0; i < NUM_CORES; i++) {
-            int num_private = cores[i]->get_count_private_access();
-            int num_shared = cores[i]->get_count_shared_access();
+            long num_private = cores[i]->get_count_private_access();
+            long num_shared = cores[i]->get_count_shared_access();
             output_log << "Core " << i << ": Private acceses = " << num_private 
                         << " | Shared accesses = " << num_shared << std::endl;
         }
 
     }
 
+    void print_tlb_miss_rate() {
+        if (cores[0]->get_tlb() == nullptr)
+            return;
+        output_log << "------------------------------" << std::endl;
+        output_log << "10. TLB miss rate for each core" << std::endl;
+        for (int i = 0; i < NUM_CORES; i++) {
+            TLB *tlb = cores[i]->get_tlb();
+            double miss_rate = tlb->count_access == 0 ? 0 : double(tlb->count_miss)/double(tlb->count_access);
+            output_log << "Core " << i << ": " << miss_rate << " (" << tlb->count_miss << " page walks)" << std::endl;
+        }
+    }
+
+    void print_memory_controller() {
+        Memory *memory = bus->memory;
+        if (!memory->is_dram())
+            return;
+        output_log << "------------------------------" << std::endl;
+        output_log << "11. DRAM row buffer hit rate and average memory latency" << std::endl;
+        double hit_rate = memory->count_access == 0 ? 0 : double(memory->count_row_hit)/double(memory->count_access);
+        double avg_latency = memory->count_access == 0 ? 0 : double(memory->total_latency)/double(memory->count_access);
+        double avg_queue_delay = memory->count_access == 0 ? 0 : double(memory->total_queue_delay)/double(memory->count_access);
+        output_log << "Accesses = " << memory->count_access << " | Row buffer hit rate = " << hit_rate << std::endl;
+        output_log << "Average latency = " << avg_latency << " | Average queueing delay = " << avg_queue_delay << std::endl;
+    }
+
+    void print_non_temporal() {
+        long bypasses = 0;
+        for (int i = 0; i < NUM_CORES; i++)
+            bypasses += cores[i]->get_cache()->count_bypass;
+        if (bypasses == 0)
+            return;
+        output_log << "------------------------------" << std::endl;
+        output_log << "12. Non-temporal misses that bypassed the cache for each core" << std::endl;
+        for (int i = 0; i < NUM_CORES; i++) {
+            LRUCache *cache = cores[i]->get_cache();
+            output_log << "Core " << i << ": " << cache->count_bypass << " bypasses | "
+                        << cache->count_pollution_avoided << " evictions avoided | "
+                        << cache->bytes_saved << " bytes of traffic saved" << std::endl;
+        }
+    }
+
+    void print_atomics() {
+        long operations = 0;
+        for (int i = 0; i < NUM_CORES; i++)
+            operations += cores[i]->get_atomic_stats().count_atomic + cores[i]->get_atomic_stats().count_fence;
+        if (operations == 0)
+            return;
+        output_log << "------------------------------" << std::endl;
+        output_log << "13. Atomic operations and fences for each core" << std::endl;
+        for (int i = 0; i < NUM_CORES; i++) {
+            const AtomicStats &stats = cores[i]->get_atomic_stats();
+            double avg_latency = stats.count_atomic == 0 ? 0 : double(stats.atomic_cycles)/double(stats.count_atomic);
+            double contention_rate = stats.count_atomic == 0 ? 0 : double(stats.count_contended)/double(stats.count_atomic);
+            output_log << "Core " << i << ": Atomics = " << stats.count_atomic << " | Average latency = " << avg_latency
+                        << " | Contention rate = " << contention_rate << " | Failed SC = " << stats.count_sc_failed
+                        << " | Fences = " << stats.count_fence << " | Fence stall cycles = " << stats.fence_stall_cycles;
+            StoreBuffer *store_buffer = cores[i]->get_store_buffer();
+            if (store_buffer != nullptr)
+                output_log << " | Store buffer full = " << store_buffer->count_full << " | Drains = " << store_buffer->count_drain;
+            output_log << std::endl;
+        }
+    }
+
+    void print_hybrid() {
+        Hybrid_Bus *hybrid = dynamic_cast<Hybrid_Bus*>(bus);
+        if (hybrid == nullptr)
+            return;
+        output_log << "------------------------------" << std::endl;
+        output_log << "14. Copies switched from update to invalidate for each core (threshold " << hybrid->threshold << ")" << std::endl;
+        for (int i = 0; i < NUM_CORES; i++)
+            output_log << "Core " << i << ": " << caches[i]->count_self_invalidation << std::endl;
+    }
+
+    void print_numa() {
+        Numa *numa = bus->numa;
+        if (numa == nullptr)
+            return;
+        output_log << "------------------------------" << std::endl;
+        output_log << "15. Local versus remote traffic for each core (" << numa->num_sockets << " sockets)" << std::endl;
+        for (int i = 0; i < NUM_CORES; i++) {
+            const NumaStats &stats = numa->stats[i];
+            output_log << "Core " << i << " (socket " << numa->socket_of(i) << "): Memory local = " << stats.local_memory
+                        << " | remote = " << stats.remote_memory << " | Cache-to-cache local = " << stats.local_transfer
+                        << " | remote = " << stats.remote_transfer << " | Remote invalidations or updates = " << stats.remote_snoop
+                        << " | Directory lookups = " << stats.directory_lookups << std::endl;
+        }
+    }
+
+    void print_threads() {
+        Scheduler *scheduler = cores[0]->get_scheduler();
+        if (scheduler == nullptr)
+            return;
+        output_log << "------------------------------" << std::endl;
+        output_log << "16. Software thread migrations and miss rate after a migration" << std::endl;
+        for (SoftwareThread *thread : scheduler->threads) {
+            double miss_rate = thread->accesses == 0 ? 0 : double(thread->misses)/double(thread->accesses);
+            double migrated_miss_rate = thread->migrated_accesses == 0 ? 0 : double(thread->migrated_misses)/double(thread->migrated_accesses);
+            output_log << "Thread " << thread->tid << ": Slices = " << thread->slices << " | Migrations = " << thread->migrations
+                        << " | Miss rate = " << miss_rate << " | After a migration = " << migrated_miss_rate
+                        << " (" << thread->migrated_misses << " misses)" << std::endl;
+        }
+    }
+
+    void print_victim_cache() {
+        if (caches[0]->victim == nullptr)
+            return;
+        output_log << "------------------------------" << std::endl;
+        output_log << "17. Victim cache hits and memory traffic saved for each core" << std::endl;
+        for (int i = 0; i < NUM_CORES; i++) {
+            VictimCache *victim = caches[i]->victim;
+            double hit_rate = victim->count_probe == 0 ? 0 : double(victim->count_hit)/double(victim->count_probe);
+            // Every hit saves a block fetch, and a dirty hit also the write-back of its eviction
+            long bytes_saved = (victim->count_hit + victim->count_dirty_hit) * block_size;
+            output_log << "Core " << i << ": Hits = " << victim->count_hit << " / " << victim->count_probe << " probes"
+                        << " | Hit rate = " << hit_rate << " | Write-backs = " << victim->count_writeback
+                        << " | " << bytes_saved << " bytes of traffic saved" << std::endl;
+        }
+    }
+
+    void print_collapsed() {
+        if (!cores[0]->collapse)
+            return;
+        output_log << "------------------------------" << std::endl;
+        output_log << "18. Hits collapsed into the preceding access to the same block for each core" << std::endl;
+        for (int i = 0; i < NUM_CORES; i++) {
+            long collapsed = cores[i]->get_count_collapsed();
+            long accesses = cores[i]->get_count_mem_instr();
+            double ratio = accesses == 0 ? 0 : double(collapsed)/double(accesses);
+            output_log << "Core " << i << ": " << collapsed << " of " << accesses << " accesses (" << ratio << ")" << std::endl;
+        }
+    }
+
+    // Peak resident set of the simulator in KB, from /proc/self/status
+    long peak_resident_kb() {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.rfind("VmHWM:", 0) == 0)
+                return std::stol(line.substr(6));
+        }
+        return 0;
+    }
+
+    // Printed to the console rather than the log, which stays deterministic
+    // Depends on host thread timing rather than on the simulation, so it also
+    // stays out of the log
+    void print_lock_contention() {
+        long acquisitions = gl->get_acquisitions();
+        long contended = gl->get_contended();
+        double contention_rate = acquisitions == 0 ? 0 : double(contended)/double(acquisitions);
+        int hottest = gl->get_hottest_set();
+        std::cout << "Set locks: " << acquisitions << " acquisitions, " << contended << " contended (rate "
+                  << contention_rate << "), most contended set " << hottest << " (" << gl->mutexes[hottest].contended << ")" << std::endl;
+    }
+
+    void print_memory_footprint() {
+        long state_bytes = 0;
+        long num_lines = 0;
+        for (int i = 0; i < NUM_CORES; i++) {
+            state_bytes += caches[i]->footprint();
+            num_lines += (long)caches[i]->num_sets * caches[i]->associativity;
+        }
+        std::cout << "Memory: " << state_bytes << " bytes of cache state (" << double(state_bytes)/double(num_lines)
+                  << " bytes per line), peak resident set " << peak_resident_kb() << " KB" << std::endl;
+    }
+
+    // Per-core interval samples as CSV next to the log, one row per interval
+    void print_intervals() {
+        if (cores[0]->get_intervals() == nullptr)
+            return;
+        std::string csv_path = output_path.substr(0, output_path.size() - 4) + ".intervals.csv";
+        std::ofstream csv(csv_path, std::ios::out);
+        csv << "core,interval,end_cycle,accesses,misses,miss_rate,bus_traffic,updates,idle_cycles" << std::endl;
+        for (int i = 0; i < NUM_CORES; i++) {
+            std::vector<IntervalSample> samples = cores[i]->get_intervals()->samples;
+            samples.push_back(cores[i]->sample());
+            IntervalSample prev = {0, 0, 0, 0, 0, 0};
+            for (size_t n = 0; n < samples.size(); n++) {
+                const IntervalSample &s = samples[n];
+                long accesses = s.accesses - prev.accesses;
+                if (accesses == 0 && s.cycle == prev.cycle)
+                    continue;
+                long misses = s.misses - prev.misses;
+                double miss_rate = accesses == 0 ? 0 : double(misses)/double(accesses);
+                csv << i << ',' << n << ',' << s.cycle << ',' << accesses << ',' << misses << ',' << miss_rate << ','
+                    << s.bus_traffic - prev.bus_traffic << ',' << s.updates - prev.updates << ',' << s.idle - prev.idle << std::endl;
+                prev = s;
+            }
+        }
+        std::cout << "DONE: The interval statistics can be found at " << csv_path << std::endl;
+    }
+
     void print_analysis(std::string path, int cache_size, int associativity) {
         std::ofstream analysis_log;
         analysis_log.open(path, std::ios::app);
@@ -152,12 +353,22 @@ public:
         print_amt_of_data_traffic();
         print_count_update();
         print_distribution_of_access();
+        print_tlb_miss_rate();
+        print_memory_controller();
+        print_non_temporal();
+        print_atomics();
+        print_hybrid();
+        print_numa();
+        print_threads();
+        print_victim_cache();
+        print_collapsed();
 
         output_log << "================== END ==================" << std::endl;
         output_log << "=========================================" << std::endl;
         output_log.close();
 
         std::cout << "DONE: The output summary can be found at " << output_path << std::endl;
+        print_intervals();
     }
 
 
@@ -1,48 +1,235 @@
+#include <algorithm>
 #include <cassert>
 
 #include "lru_cache.h"
 #include "bus.h"
 #include "config.h"
 
-// Returns the cycles taken: 100 if write back, 0 if not
-int LRUCache::remove(CacheBlock* cacheBlock)
+bool LRUCache::counts_as_dirty(int status)
 {
-    CacheBlock *p = cacheBlock->prev;
-    CacheBlock *n = cacheBlock->next;
-    p->next = n;
-    n->prev = p;
-    if (cacheBlock->status == MESI_status::M || cacheBlock->status == Dragon_status::Md || cacheBlock->status == Dragon_status::Sm)
+    return status == MESI_status::M || status == Dragon_status::Md || status == Dragon_status::Sm;
+}
+
+// Newest stamp of the set. Small sets take it from their ways, so they need no
+// counter of their own
+uint64_t LRUCache::last_stamp(int set_num)
+{
+    if (associativity > SCAN_WAYS)
+        return stamps[set_num];
+    uint64_t last = 0;
+    const uint64_t *set = &lines[(size_t)set_num * associativity];
+    for (int way = 0; way < associativity; ++way)
+    {
+        if (set[way] & VALID)
+            last = std::max(last, set[way] & STAMP_MASK);
+    }
+    return last;
+}
+
+void LRUCache::touch(int set_num, int way)
+{
+    if (associativity == 1)
+        return;
+    uint64_t last = last_stamp(set_num);
+    if (last == STAMP_MASK)
+    {
+        renumber(set_num);
+        last = last_stamp(set_num);
+    }
+    line(set_num, way) = (line(set_num, way) & ~STAMP_MASK) | ++last;
+    if (associativity > SCAN_WAYS)
+        stamps[set_num] = last;
+}
+
+// Compacts the stamps of a set to 0..n-1 in LRU order once they run out
+void LRUCache::renumber(int set_num)
+{
+    std::vector<int> order;
+    for (int way = 0; way < associativity; ++way)
+    {
+        if (line(set_num, way) & VALID)
+            order.push_back(way);
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return (line(set_num, a) & STAMP_MASK) < (line(set_num, b) & STAMP_MASK);
+    });
+    for (size_t i = 0; i < order.size(); ++i)
+        line(set_num, order[i]) = (line(set_num, order[i]) & ~STAMP_MASK) | i;
+    if (associativity > SCAN_WAYS)
+        stamps[set_num] = order.size();
+}
+
+int LRUCache::allocate(int set_num, int tag, int status)
+{
+    int way = 0;
+    while (line(set_num, way) & VALID)
+        ++way;
+    assert(way < associativity);
+    line(set_num, way) = ((uint64_t)(uint32_t)tag << TAG_SHIFT) | ((uint64_t)status << STATE_SHIFT) | VALID;
+    touch(set_num, way);
+    if (associativity > SCAN_WAYS)
+        ways[set_num][tag] = way;
+    return way;
+}
+
+void LRUCache::release(int set_num, int way)
+{
+    if (associativity > SCAN_WAYS)
+        ways[set_num].erase(get_tag(set_num, way));
+    line(set_num, way) = 0;
+}
+
+int LRUCache::lru_way(int set_num)
+{
+    int lru = -1;
+    for (int way = 0; way < associativity; ++way)
+    {
+        uint64_t l = line(set_num, way);
+        if (!(l & VALID))
+            return -1;
+        if (lru < 0 || (l & STAMP_MASK) < (line(set_num, lru) & STAMP_MASK))
+            lru = way;
+    }
+    return lru;
+}
+
+long LRUCache::footprint()
+{
+    long bytes = lines.size() * sizeof(uint64_t) + stamps.size() * sizeof(uint32_t);
+    for (std::unordered_map<int, int> &set : ways)
+    {
+        // One node of a key, a value and a next pointer per entry, plus the bucket array
+        bytes += set.size() * (sizeof(std::pair<const int, int>) + sizeof(void*)) + set.bucket_count() * sizeof(void*);
+    }
+    return bytes;
+}
+
+void LRUCache::lock_access(int set_num, int tag)
+{
+    gl->lockIdx(set_num);
+    if (bus->events && !bus->events->pending[pid].started)
+    {
+        // An access that calls the cache twice keeps its first state
+        bus->events->pending[pid].started = true;
+        bus->events->pending[pid].old_state = get_status(set_num, tag);
+    }
+}
+
+void LRUCache::unlock_access(int set_num, int tag)
+{
+    if (bus->events)
+        bus->events->pending[pid].new_state = get_status(set_num, tag);
+    gl->unlockIdx(set_num);
+}
+
+// Returns true if the block is dirty and has to be written back
+bool LRUCache::remove(int set_num, int way)
+{
+    if (counts_as_dirty(get_state(set_num, way)))
     {
         // Write-Back
         ++count_data_traffic;
-        return 100;
+        return true;
     }
     else 
     {
-        return 0;
+        return false;
+    }
+}
+
+int LRUCache::removeLRUIfFull(int set_num)
+{
+    int cycles = 0;
+    int lru = lru_way(set_num);
+    if (lru >= 0)
+    {
+        int lru_tag = get_tag(set_num, lru);
+        int status = get_state(set_num, lru);
+        bool dirty = false;
+        if (victim != nullptr && status != invalid_status())
+        {
+            // The line moves to the victim cache, which writes back whatever dirty line it displaces
+            VictimLine displaced;
+            if (victim->insert(set_num, lru_tag, status, displaced) && is_dirty(displaced.status))
+            {
+                ++count_data_traffic;
+                ++victim->count_writeback;
+                cycles += bus->MemWr(pid, displaced.set_num, displaced.tag);
+            }
+        }
+        else
+        {
+            dirty = remove(set_num, lru);
+            if (dirty)
+                cycles += bus->MemWr(pid, set_num, lru_tag);
+        }
+        clear_reservation(set_num, lru_tag);
+        if (bus->events)
+            bus->trace_event(pid, pid, set_num, lru_tag, status, invalid_status(), BusOp::eviction | (dirty ? BusOp::write_back : 0), cycles);
+        release(set_num, lru);
     }
+    return cycles;
 }
 
-void LRUCache::insert(CacheBlock* cacheBlock, int set_num)
+int LRUCache::recall(int set_num, int tag, int& cycles)
 {
-    CacheBlock *p = lasts[set_num]->prev;
-    CacheBlock *n = lasts[set_num];
-    p->next = cacheBlock;
-    n->prev = cacheBlock;
-    cacheBlock->prev = p;
-    cacheBlock->next = n;
+    int status = victim->take(set_num, tag);
+    if (status < 0)
+        return -1;
+    if (is_dirty(status))
+        ++victim->count_dirty_hit;
+    // The slot just freed takes the line this one displaces from the set
+    cycles += latency.victim + removeLRUIfFull(set_num);
+    return allocate(set_num, tag, status);
 }
 
-int LRUCache::removeLRUIfFull(int set_num, int associativity)
+void LRUCache::reserve(int set_num, int tag)
 {
-    int cycles = 0;
-    if (cache[set_num].size() >= associativity)
+    reservation = (long)tag * num_sets + set_num;
+}
+
+void LRUCache::clear_reservation(int set_num, int tag)
+{
+    long expected = (long)tag * num_sets + set_num;
+    reservation.compare_exchange_strong(expected, -1);
+}
+
+bool LRUCache::take_reservation(int set_num, int tag)
+{
+    return reservation.exchange(-1) == (long)tag * num_sets + set_num;
+}
+
+bool LRUCache::unused_update(int set_num, int tag, int threshold)
+{
+    int way = find(set_num, tag);
+    if (way < 0)
+        return false;
+    uint64_t &l = line(set_num, way);
+    uint64_t unused = std::min<uint64_t>(((l & UNUSED_MASK) >> UNUSED_SHIFT) + 1, UNUSED_MASK >> UNUSED_SHIFT);
+    l = (l & ~UNUSED_MASK) | (unused << UNUSED_SHIFT);
+    if ((int)unused < threshold)
+        return false;
+    // An updated copy is always clean (Sc), so it is dropped without a write-back
+    remove(set_num, way);
+    release(set_num, way);
+    clear_reservation(set_num, tag);
+    ++count_self_invalidation;
+    return true;
+}
+
+void LRUCache::record_bypass(int set_num)
+{
+    ++count_bypass;
+    // Only one word crosses the bus instead of the whole block
+    bytes_saved += block_size - latency.word_size;
+    int lru = lru_way(set_num);
+    if (lru >= 0)
     {
-        CacheBlock *lru = firsts[set_num]->next;
-        cycles += remove(lru);
-        cache[set_num].erase(lru->tag);
+        // Allocating would have evicted the LRU block, and written it back if dirty
+        ++count_pollution_avoided;
+        if (is_dirty(get_state(set_num, lru)))
+            bytes_saved += block_size;
     }
-    return cycles;
 }
 
 /*
@@ -50,18 +237,21 @@ int LRUCache::removeLRUIfFull(int set_num, int associativity)
 MESI Cache Protocol APIs
 ****************************************************
 */
-int MESI_Cache::pr_read(int set_num, int tag)
+int MESI_Cache::pr_read(int set_num, int tag, bool non_temporal)
 {
-    gl->lockIdx(set_num);
-    if (cache[set_num].find(tag) != cache[set_num].end())
+    int hit_cycles = latency.hit;
+    lock_access(set_num, tag);
+    int way = find(set_num, tag);
+    if (way < 0 && victim != nullptr)
+        way = recall(set_num, tag, hit_cycles);
+    if (way >= 0)
     {
-        CacheBlock *cacheBlock = cache[set_num][tag];
-        remove(cacheBlock);
-        if (cache[set_num][tag]->status != MESI_status::I)
+        remove(set_num, way);
+        if (get_state(set_num, way) != MESI_status::I)
         {
             // Read Hit
-            insert(cacheBlock, set_num); // reinsert to make it most recently used
-            switch (cacheBlock->status) {
+            touch(set_num, way); // reinsert to make it most recently used
+            switch (get_state(set_num, way)) {
                 case MESI_status::M: // fallthrough
                 case MESI_status::E:
                     ++count_private_access;
@@ -70,18 +260,24 @@ int MESI_Cache::pr_read(int set_num, int tag)
                     ++count_shared_access;
                     break;
             }
-            gl->unlockIdx(set_num);
-            return 1;
+            unlock_access(set_num, tag);
+            return hit_cycles;
         }
         else
         {
             // Exists in cache but it has been invalidated (stale)
-            cache[set_num].erase(cacheBlock->tag);
+            release(set_num, way);
         }
     }
 
     // Read Miss
-    int count_cycles = removeLRUIfFull(set_num, associativity);
+    if (non_temporal)
+    {
+        int count_cycles = read_bypass(set_num, tag);
+        unlock_access(set_num, tag);
+        return count_cycles;
+    }
+    int count_cycles = removeLRUIfFull(set_num);
 
     ++count_cache_miss;
     ++count_data_traffic;
@@ -91,105 +287,174 @@ int MESI_Cache::pr_read(int set_num, int tag)
         // I -> E
         // Fetch block from memory
         ++count_private_access;
-        count_cycles += 100;
-        cache[set_num][tag] = new CacheBlock(tag, MESI_status::E);
+        count_cycles += bus->MemRd(pid, set_num, tag);
+        allocate(set_num, tag, MESI_status::E);
     }
     else 
     {
         // I -> S
         // Fetch block from another cache
         ++count_shared_access;
-        count_cycles += 2 * (block_size/4);
-        cache[set_num][tag] = new CacheBlock(tag, MESI_status::S);
+        count_cycles += latency.transfer(block_size);
+        allocate(set_num, tag, MESI_status::S);
     }
-    insert(cache[set_num][tag], set_num);
-    gl->unlockIdx(set_num);
+    unlock_access(set_num, tag);
     return count_cycles;
 }
 
-int MESI_Cache::pr_write(int set_num, int tag)
+int MESI_Cache::pr_write(int set_num, int tag, bool non_temporal)
 {
-    int count_cycles = 1;
+    int count_cycles = latency.hit;
     int count_invalidations = 0;
-    gl->lockIdx(set_num);
-    if (cache[set_num].find(tag) != cache[set_num].end())
+    lock_access(set_num, tag);
+    int way = find(set_num, tag);
+    if (way < 0 && victim != nullptr)
+        way = recall(set_num, tag, count_cycles);
+    if (way >= 0)
     {
-        CacheBlock *cacheBlock = cache[set_num][tag];
-        remove(cacheBlock);
-        if (cacheBlock->status != MESI_status::I)
+        remove(set_num, way);
+        if (get_state(set_num, way) != MESI_status::I)
         {
             // Write Hit
-            switch (cacheBlock->status) {
+            switch (get_state(set_num, way)) {
                 case MESI_status::M:
                     ++count_private_access;
                     break;
                 case MESI_status::E:
                     ++count_private_access;
-                    cacheBlock->status = MESI_status::M;
+                    set_state(set_num, way, MESI_status::M);
                     break;
                 case MESI_status::S:
                     ++count_shared_access;
-                    cacheBlock->status = MESI_status::M;
+                    set_state(set_num, way, MESI_status::M);
                     count_invalidations = bus->BusUpd(pid, set_num, tag);
                     count_update += count_invalidations;
-                    count_cycles += 2 * count_invalidations; // only need to invalidate, not sending the word
+                    count_cycles += latency.invalidation * count_invalidations; // only need to invalidate, not sending the word
                     break;
             }
-            insert(cacheBlock, set_num); // reinsert
-            gl->unlockIdx(set_num);
+            touch(set_num, way); // reinsert
+            unlock_access(set_num, tag);
             return count_cycles;
         }
         else
         {
             // Exists in cache but it has been invalidated (stale)
-            cache[set_num].erase(cacheBlock->tag);
-            remove(cacheBlock);
+            remove(set_num, way);
+            release(set_num, way);
         }
     }
 
     // Write Miss
+    if (non_temporal)
+    {
+        count_cycles += write_bypass(set_num, tag);
+        unlock_access(set_num, tag);
+        return count_cycles;
+    }
     // Read block into cache
     ++count_cache_miss;
     ++count_data_traffic;
 
-    count_cycles += removeLRUIfFull(set_num, associativity);
+    count_cycles += removeLRUIfFull(set_num);
 
     if (bus->BusRd(pid, set_num, tag) == MESI_status::I)
     {
         // Fetch block from memory
         ++count_private_access;
-        count_cycles += 100;
+        count_cycles += bus->MemRd(pid, set_num, tag);
     }
     else
     {
         // Fetch block from another cache
-        count_cycles += 2*(block_size/4);
+        count_cycles += latency.transfer(block_size);
 
         count_invalidations = bus->BusUpd(pid, set_num, tag); // equivalent to BusRdX
         count_update += count_invalidations;
         ++count_shared_access;
 
-        count_cycles += 2 * count_invalidations;
+        count_cycles += latency.invalidation * count_invalidations;
     }
-    cache[set_num][tag] = new CacheBlock(tag, MESI_status::M);
-    insert(cache[set_num][tag], set_num);
+    allocate(set_num, tag, MESI_status::M);
 
-    gl->unlockIdx(set_num);
+    unlock_access(set_num, tag);
     return count_cycles;
 }
 
-int MESI_Cache::get_status(int set_num, int tag)
+int MESI_Cache::read_bypass(int set_num, int tag)
+{
+    ++count_cache_miss;
+    record_bypass(set_num);
+    if (bus->BusRd(pid, set_num, tag) == MESI_status::I)
+    {
+        // Read the word from memory
+        ++count_private_access;
+        return bus->MemRd(pid, set_num, tag);
+    }
+    // Read the word from another cache
+    ++count_shared_access;
+    return latency.word_transfer;
+}
+
+int MESI_Cache::write_bypass(int set_num, int tag)
 {
-    if (cache[set_num].find(tag) != cache[set_num].end())
-        return cache[set_num][tag]->status;
+    ++count_cache_miss;
+    record_bypass(set_num);
+    // Take the dirty data first, as a write miss does, so a copy in M is
+    // written back before it is invalidated
+    if (bus->BusRd(pid, set_num, tag) == MESI_status::I)
+    {
+        // No other copy: write the word to memory
+        ++count_private_access;
+        return bus->MemWr(pid, set_num, tag);
+    }
+    // Invalidate every other copy and write the word to memory
+    ++count_shared_access;
+    int count_invalidations = bus->BusUpd(pid, set_num, tag, false);
+    count_update += count_invalidations;
+    return latency.invalidation * count_invalidations + bus->MemWr(pid, set_num, tag);
+}
+
+long MESI_Cache::replay_hits(int set_num, int tag, bool write, long count)
+{
+    gl->lockIdx(set_num);
+    int way = find(set_num, tag);
+    int status = way >= 0 ? get_state(set_num, way) : MESI_status::I;
+    // A write hit only stays silent in M, where the previous write left the block
+    if (status == MESI_status::I || (write && status != MESI_status::M))
+    {
+        gl->unlockIdx(set_num);
+        return -1;
+    }
+    // Counted like pr_read and pr_write count each hit
+    if (counts_as_dirty(status))
+        count_data_traffic += count;
+    if (status == MESI_status::S)
+        count_shared_access += count;
     else
-        return MESI_status::I;
+        count_private_access += count;
+    touch(set_num, way);
+    gl->unlockIdx(set_num);
+    return count * latency.hit;
+}
+
+int MESI_Cache::get_status(int set_num, int tag)
+{
+    int way = find(set_num, tag);
+    if (way >= 0)
+        return get_state(set_num, way);
+    int status = victim != nullptr ? victim->get_status(set_num, tag) : -1;
+    return status >= 0 ? status : MESI_status::I;
 }
 
 void MESI_Cache::set_status(int set_num, int tag, int new_status)
 {
-    if (cache[set_num].find(tag) != cache[set_num].end())
-        cache[set_num][tag]->status = new_status;
+    int way = find(set_num, tag);
+    if (way >= 0)
+        set_state(set_num, way, new_status);
+    else if (victim != nullptr && new_status == invalid_status())
+        victim->erase(set_num, tag);
+    else if (victim != nullptr)
+        victim->set_status(set_num, tag, new_status);
 }
 
 /*
@@ -197,18 +462,22 @@ void MESI_Cache::set_status(int set_num, int tag, int new_status)
 Dragon Cache Protocol APIs
 ****************************************************
 */
-int Dragon_Cache::pr_read(int set_num, int tag)
+int Dragon_Cache::pr_read(int set_num, int tag, bool non_temporal)
 {
-    gl->lockIdx(set_num);
-    if (cache[set_num].find(tag) != cache[set_num].end())
+    int hit_cycles = latency.hit;
+    lock_access(set_num, tag);
+    int way = find(set_num, tag);
+    if (way < 0 && victim != nullptr)
+        way = recall(set_num, tag, hit_cycles);
+    if (way >= 0)
     {
-        CacheBlock *cacheBlock = cache[set_num][tag];
-        remove(cacheBlock);
-        if (cache[set_num][tag]->status != Dragon_status::not_found)
+        remove(set_num, way);
+        if (get_state(set_num, way) != Dragon_status::not_found)
         {
             // Read Hit
-            insert(cacheBlock, set_num); // reinsert to make it most recently used
-            switch (cacheBlock->status) {
+            reset_unused_updates(set_num, way);
+            touch(set_num, way); // reinsert to make it most recently used
+            switch (get_state(set_num, way)) {
                 case Dragon_status::Md: // fallthrough
                 case Dragon_status::Ed:
                     ++count_private_access;
@@ -218,21 +487,27 @@ int Dragon_Cache::pr_read(int set_num, int tag)
                     ++count_shared_access;
                     break;
             }
-            gl->unlockIdx(set_num);
-            return 1;
+            unlock_access(set_num, tag);
+            return hit_cycles;
         }
         else
         {
             // Else condition should never happen because there's no invalidation 
             // Exists in cache but it has been invalidated (stale)
             std::cout << "ERROR: Invalidated Dragon cache." << std::endl;
-            cache[set_num].erase(cacheBlock->tag);
-            remove(cacheBlock);
+            remove(set_num, way);
+            release(set_num, way);
         }
     }
 
     // Read Miss
-    int count_cycles = removeLRUIfFull(set_num, associativity);
+    if (non_temporal)
+    {
+        int count_cycles = read_bypass(set_num, tag);
+        unlock_access(set_num, tag);
+        return count_cycles;
+    }
+    int count_cycles = removeLRUIfFull(set_num);
 
     ++count_cache_miss;
     ++count_data_traffic;
@@ -242,41 +517,43 @@ int Dragon_Cache::pr_read(int set_num, int tag)
         // not_found -> E
         // Fetch block from memory
         ++count_private_access;
-        count_cycles += 100;
-        cache[set_num][tag] = new CacheBlock(tag, Dragon_status::Ed);
+        count_cycles += bus->MemRd(pid, set_num, tag);
+        allocate(set_num, tag, Dragon_status::Ed);
     }
     else 
     {
         // not_found -> Sc
         // Fetch block from another cache
         ++count_shared_access;
-        count_cycles += 2 * (block_size/4);
-        cache[set_num][tag] = new CacheBlock(tag, Dragon_status::Sc);
+        count_cycles += latency.transfer(block_size);
+        allocate(set_num, tag, Dragon_status::Sc);
     }
-    insert(cache[set_num][tag], set_num);
-    gl->unlockIdx(set_num);
+    unlock_access(set_num, tag);
     return count_cycles;
 }
 
-int Dragon_Cache::pr_write(int set_num, int tag)
+int Dragon_Cache::pr_write(int set_num, int tag, bool non_temporal)
 {
-    int count_cycles = 1;
+    int count_cycles = latency.hit;
     int count_invalidations = 0;
-    gl->lockIdx(set_num);
-    if (cache[set_num].find(tag) != cache[set_num].end())
+    lock_access(set_num, tag);
+    int way = find(set_num, tag);
+    if (way < 0 && victim != nullptr)
+        way = recall(set_num, tag, count_cycles);
+    if (way >= 0)
     {
-        CacheBlock *cacheBlock = cache[set_num][tag];
-        remove(cacheBlock);
-        if (cacheBlock->status != Dragon_status::not_found)
+        remove(set_num, way);
+        if (get_state(set_num, way) != Dragon_status::not_found)
         {
             // Write Hit
-            switch (cacheBlock->status) {
+            reset_unused_updates(set_num, way);
+            switch (get_state(set_num, way)) {
                 case Dragon_status::Md:
                     ++count_private_access;
                     break;
                 case Dragon_status::Ed:
                     ++count_private_access;
-                    cacheBlock->status = Dragon_status::Md;
+                    set_state(set_num, way, Dragon_status::Md);
                     break;
                 case Dragon_status::Sc:
                 case Dragon_status::Sm:
@@ -284,7 +561,7 @@ int Dragon_Cache::pr_write(int set_num, int tag)
                     {
                         // Not found in other cache
                         ++count_private_access;
-                        cacheBlock->status = Dragon_status::Md;
+                        set_state(set_num, way, Dragon_status::Md);
                     }
                     else
                     {
@@ -292,15 +569,15 @@ int Dragon_Cache::pr_write(int set_num, int tag)
                         // Each write to another cache block incurs 2N cycles
                         ++count_shared_access;
                         count_invalidations = bus->BusUpd(pid, set_num, tag);
-                        cacheBlock->status = Dragon_status::Sm;
+                        set_state(set_num, way, Dragon_status::Sm);
                         count_update += count_invalidations;
                         count_data_traffic += count_invalidations;
-                        count_cycles += count_invalidations * 2 * (block_size/4);
+                        count_cycles += count_invalidations * latency.transfer(block_size);
                     }
                     break;
             }
-            insert(cacheBlock, set_num); // reinsert
-            gl->unlockIdx(set_num);
+            touch(set_num, way); // reinsert
+            unlock_access(set_num, tag);
             return count_cycles;
         }
         else
@@ -308,54 +585,122 @@ int Dragon_Cache::pr_write(int set_num, int tag)
             // Else condition should never happen because there's no invalidation 
             // Exists in cache but it has been invalidated (stale)
             std::cout << "ERROR: Invalidated Dragon cache." << std::endl;
-            cache[set_num].erase(cacheBlock->tag);
-            remove(cacheBlock);
+            remove(set_num, way);
+            release(set_num, way);
         }
     }
 
     // Write Miss
+    if (non_temporal)
+    {
+        count_cycles += write_bypass(set_num, tag);
+        unlock_access(set_num, tag);
+        return count_cycles;
+    }
     // Read block into cache
     ++count_cache_miss;
     ++count_data_traffic;
 
-    count_cycles += removeLRUIfFull(set_num, associativity);
+    count_cycles += removeLRUIfFull(set_num);
 
     if (bus->BusRd(pid, set_num, tag) == Dragon_status::not_found)
     {
         // Fetch block from memory
         ++count_private_access;
-        count_cycles += 100;
-        cache[set_num][tag] = new CacheBlock(tag, Dragon_status::Md);
+        count_cycles += bus->MemRd(pid, set_num, tag);
+        allocate(set_num, tag, Dragon_status::Md);
     }
     else
     {
         // Fetch block from another cache
-        count_cycles += 2*(block_size/4);
-        cache[set_num][tag] = new CacheBlock(tag, Dragon_status::Sm);
+        count_cycles += latency.transfer(block_size);
+        allocate(set_num, tag, Dragon_status::Sm);
 
         count_invalidations = bus->BusUpd(pid, set_num, tag);
         count_update += count_invalidations;
         count_data_traffic += count_invalidations;
         ++count_shared_access;
 
-        count_cycles += 2*count_invalidations*(block_size/4);
+        count_cycles += count_invalidations * latency.transfer(block_size);
     }
-    insert(cache[set_num][tag], set_num);
 
-    gl->unlockIdx(set_num);
+    unlock_access(set_num, tag);
     return count_cycles;
 }
 
-int Dragon_Cache::get_status(int set_num, int tag)
+int Dragon_Cache::read_bypass(int set_num, int tag)
+{
+    ++count_cache_miss;
+    record_bypass(set_num);
+    if (bus->BusRd(pid, set_num, tag) == Dragon_status::not_found)
+    {
+        // Read the word from memory
+        ++count_private_access;
+        return bus->MemRd(pid, set_num, tag);
+    }
+    // Read the word from another cache
+    ++count_shared_access;
+    return latency.word_transfer;
+}
+
+int Dragon_Cache::write_bypass(int set_num, int tag)
+{
+    ++count_cache_miss;
+    record_bypass(set_num);
+    if (bus->BusRd(pid, set_num, tag) == Dragon_status::not_found)
+    {
+        // No other copy: write the word to memory
+        ++count_private_access;
+        return bus->MemWr(pid, set_num, tag);
+    }
+    // Update the word in every other copy, the owner writes the block back
+    // since the writer does not take it over
+    ++count_shared_access;
+    int count_updates = bus->BusUpd(pid, set_num, tag, false);
+    count_update += count_updates;
+    count_data_traffic += count_updates;
+    return latency.word_transfer * count_updates;
+}
+
+long Dragon_Cache::replay_hits(int set_num, int tag, bool write, long count)
 {
-    if (cache[set_num].find(tag) != cache[set_num].end())
-        return cache[set_num][tag]->status;
+    gl->lockIdx(set_num);
+    int way = find(set_num, tag);
+    int status = way >= 0 ? get_state(set_num, way) : Dragon_status::not_found;
+    // Writes to a shared copy broadcast an update every time
+    if (status == Dragon_status::not_found || (write && status != Dragon_status::Md))
+    {
+        gl->unlockIdx(set_num);
+        return -1;
+    }
+    if (counts_as_dirty(status))
+        count_data_traffic += count;
+    if (status == Dragon_status::Sm || status == Dragon_status::Sc)
+        count_shared_access += count;
     else
-        return Dragon_status::not_found;
+        count_private_access += count;
+    reset_unused_updates(set_num, way);
+    touch(set_num, way);
+    gl->unlockIdx(set_num);
+    return count * latency.hit;
+}
+
+int Dragon_Cache::get_status(int set_num, int tag)
+{
+    int way = find(set_num, tag);
+    if (way >= 0)
+        return get_state(set_num, way);
+    int status = victim != nullptr ? victim->get_status(set_num, tag) : -1;
+    return status >= 0 ? status : Dragon_status::not_found;
 }
 
 void Dragon_Cache::set_status(int set_num, int tag, int new_status)
 {
-    if (cache[set_num].find(tag) != cache[set_num].end())
-        cache[set_num][tag]->status = new_status;
+    int way = find(set_num, tag);
+    if (way >= 0)
+        set_state(set_num, way, new_status);
+    else if (victim != nullptr && new_status == invalid_status())
+        victim->erase(set_num, tag);
+    else if (victim != nullptr)
+        victim->set_status(set_num, tag, new_status);
 }
\ No newline at end of file
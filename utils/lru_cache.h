@@ -1,29 +1,47 @@
 #ifndef _LRU_CACHE_H
 #define _LRU_CACHE_H
 
+#include <atomic>
+#include <cstdint>
 #include <vector>
 #include <unordered_map>
 
 #include "global_lock.h"
 #include "config.h"
+#include "latency.h"
+#include "victim_cache.h"
 
 class Bus;
 
-class CacheBlock {
-public:
-    int tag;
-    int status;
-    CacheBlock *prev;
-    CacheBlock *next;
-    CacheBlock(int _tag, int _status)
-    : tag(_tag)
-    , status(_status)
-    , prev(nullptr)
-    , next(nullptr)
-    {}
-};
-
+/**
+ * Cache Lines
+ * Every way of a set is packed into one 64-bit word: the tag in the high
+ * 32 bits, then 3 bits of protocol state, a valid bit, 4 bits counting the
+ * updates the Hybrid protocol received without a local access and a 24-bit
+ * recency stamp. The LRU way of a full set is the one with the smallest stamp.
+ * Sets of up to SCAN_WAYS ways are searched linearly and take the next stamp
+ * from their newest way, so they cost 8 bytes per line. Larger sets also keep
+ * a tag -> way map and a stamp counter.
+*/
 class LRUCache {
+private:
+    static const int SCAN_WAYS = 16;
+    static const int TAG_SHIFT = 32;
+    static const int STATE_SHIFT = 29;
+    static const uint64_t STATE_MASK = 0x7ULL << STATE_SHIFT;
+    static const uint64_t VALID = 1ULL << 28;
+    static const int UNUSED_SHIFT = 24;
+    static const uint64_t UNUSED_MASK = 0xFULL << UNUSED_SHIFT;
+    static const uint64_t STAMP_MASK = (1ULL << UNUSED_SHIFT) - 1;
+
+    std::vector<uint64_t> lines;  // associativity ways per set
+    std::vector<uint32_t> stamps; // last recency stamp handed out in each set, only above SCAN_WAYS
+    std::vector<std::unordered_map<int, int>> ways; // tag -> way, only above SCAN_WAYS
+
+    uint64_t& line(int set_num, int way) { return lines[(size_t)set_num * associativity + way]; }
+    uint64_t last_stamp(int set_num);
+    void renumber(int set_num);
+
 public:
     int pid;
     int num_sets;
@@ -31,9 +49,8 @@ public:
     int block_size;
     Bus *bus;
     GlobalLock *gl;
-    std::vector<std::unordered_map<int, CacheBlock*>> cache;
-    std::vector<CacheBlock*> firsts;
-    std::vector<CacheBlock*> lasts;
+    Latency latency;
+    VictimCache *victim = nullptr; // optional, catches evicted lines
 
     LRUCache(int _cache_size, int _associativity, int _block_size, int _pid, Bus* _bus, GlobalLock* _gl)
     : pid(_pid)
@@ -43,34 +60,107 @@ public:
     , bus(_bus)
     , gl(_gl)
     {
-        cache.resize(num_sets);
-        firsts.resize(num_sets);
-        lasts.resize(num_sets);
-        for (int i = 0; i < num_sets; ++i)
+        lines.resize((size_t)num_sets * associativity);
+        if (associativity > SCAN_WAYS)
         {
-            firsts[i] = new CacheBlock(-1, -1);
-            lasts[i] = new CacheBlock(-1, -1);
-            firsts[i]->next = lasts[i];
-            lasts[i]->prev = firsts[i];
+            stamps.resize(num_sets);
+            ways.resize(num_sets);
         }
     }
 
     // Statistics
-    int count_cache_miss = 0;
-    int count_data_traffic = 0;
-    int count_update = 0; // Number of invalidations or updates on the bus
-    int count_private_access = 0;
-    int count_shared_access = 0;
+    long count_cache_miss = 0;
+    std::atomic<long> count_data_traffic = 0; // also written by other cores on write-back
+    long count_update = 0; // Number of invalidations or updates on the bus
+    long count_private_access = 0;
+    long count_shared_access = 0;
+    long count_found_elsewhere = 0; // bus transactions of this core that found the block in another cache
+    long count_bypass = 0;            // non-temporal misses that did not allocate
+    long count_pollution_avoided = 0; // of which would have evicted a block
+    long bytes_saved = 0;             // bus bytes not moved thanks to bypassing
+
+    // Block reserved by the last load-linked, -1 = none. Cleared when another
+    // core writes the block or when it is evicted
+    std::atomic<long> reservation = -1;
+    void reserve(int set_num, int tag);
+    void clear_reservation(int set_num, int tag);
+    // Returns true if the block was still reserved, always drops the reservation
+    bool take_reservation(int set_num, int tag);
+
+    std::atomic<long> count_self_invalidation = 0; // written by the updating core
+    // Hybrid protocol: counts an update of a copy that the core has not used
+    // since the previous one, and drops the copy once `threshold` pile up.
+    // Returns true if the copy was dropped
+    bool unused_update(int set_num, int tag, int threshold);
+
+    // Write-back test of remove(), kept from the original simulator: it
+    // compares MESI and Dragon states as plain ints, so MESI S and Dragon Ed
+    // count as dirty too
+    bool counts_as_dirty(int status);
+    // True if a line in this protocol state holds data memory does not have
+    virtual bool is_dirty(int status) = 0;
+
+    // Way holding tag in the set, -1 if absent
+    int find(int set_num, int tag)
+    {
+        if (associativity > SCAN_WAYS)
+        {
+            auto it = ways[set_num].find(tag);
+            return it == ways[set_num].end() ? -1 : it->second;
+        }
+        const uint64_t *set = &lines[(size_t)set_num * associativity];
+        const uint64_t key = ((uint64_t)(uint32_t)tag << TAG_SHIFT) | VALID;
+        const uint64_t mask = (~0ULL << TAG_SHIFT) | VALID;
+        for (int way = 0; way < associativity; ++way)
+        {
+            if ((set[way] & mask) == key)
+                return way;
+        }
+        return -1;
+    }
+    int get_tag(int set_num, int way) { return (int)(line(set_num, way) >> TAG_SHIFT); }
+    int get_state(int set_num, int way) { return (line(set_num, way) & STATE_MASK) >> STATE_SHIFT; }
+    void set_state(int set_num, int way, int status)
+    {
+        line(set_num, way) = (line(set_num, way) & ~STATE_MASK) | ((uint64_t)status << STATE_SHIFT);
+    }
+    void reset_unused_updates(int set_num, int way) { line(set_num, way) &= ~UNUSED_MASK; }
+    // Makes the way the most recently used of its set
+    void touch(int set_num, int way);
+    // Fills a free way of the set, returns it
+    int allocate(int set_num, int tag, int status);
+    void release(int set_num, int way);
+    // Least recently used way, -1 if the set still has a free way
+    int lru_way(int set_num);
+    // Bytes of line state held for the simulated cache
+    long footprint();
+
+    // Take and release the set lock around an access. When tracing events,
+    // they capture the requester's own transition inside the critical section
+    void lock_access(int set_num, int tag);
+    void unlock_access(int set_num, int tag);
+
+    bool remove(int set_num, int way);
+    int removeLRUIfFull(int set_num);
+    // Swaps a missing block back in from the victim cache, adding the cycles
+    // spent. Returns its way, -1 if the victim cache does not hold it either
+    int recall(int set_num, int tag, int& cycles);
+    void record_bypass(int set_num);
 
-    int remove(CacheBlock* cacheBlock);
-    void insert(CacheBlock* cacheBlock, int set_num);
-    int removeLRUIfFull(int set_num, int associativity);
+    // Non-temporal accesses that miss do not allocate: one word moves between
+    // the core and memory or the caches that hold the block
+    virtual int pr_read(int set_num, int tag, bool non_temporal = false) = 0;
+    virtual int pr_write(int set_num, int tag, bool non_temporal = false) = 0;
 
-    virtual int pr_read(int set_num, int tag) = 0;
-    virtual int pr_write(int set_num, int tag) = 0;
+    // Collapsed replay: counts `count` more accesses to a block like the hits
+    // they would be and returns their cycles, or -1 without counting anything
+    // if they would not all hit without a bus transaction
+    virtual long replay_hits(int set_num, int tag, bool write, long count) = 0;
 
     virtual int get_status(int set_num, int tag) = 0;
     virtual void set_status(int set_num, int tag, int new_status) = 0;
+    // Status of a block that is not in the cache
+    virtual int invalid_status() = 0;
 };
 
 class MESI_Cache : public LRUCache {
@@ -78,10 +168,15 @@ public:
     MESI_Cache(int _cache_size, int _associativity, int _block_size, int _pid, Bus* _bus, GlobalLock* _gl)
     : LRUCache(_cache_size, _associativity, _block_size, _pid, _bus, _gl)
     {}
-    int pr_read(int set_num, int tag);
-    int pr_write(int set_num, int tag);
+    int pr_read(int set_num, int tag, bool non_temporal = false);
+    int pr_write(int set_num, int tag, bool non_temporal = false);
+    int read_bypass(int set_num, int tag);
+    int write_bypass(int set_num, int tag);
+    long replay_hits(int set_num, int tag, bool write, long count);
     int get_status(int set_num, int tag);
     void set_status(int set_num, int tag, int new_status);
+    int invalid_status() { return MESI_status::I; }
+    bool is_dirty(int status) { return status == MESI_status::M; }
 };
 
 class Dragon_Cache : public LRUCache {
@@ -89,10 +184,15 @@ public:
     Dragon_Cache(int _cache_size, int _associativity, int _block_size, int _pid, Bus* _bus, GlobalLock* _gl)
     : LRUCache(_cache_size, _associativity, _block_size, _pid, _bus, _gl)
     {}
-    int pr_read(int set_num, int tag);
-    int pr_write(int set_num, int tag);
+    int pr_read(int set_num, int tag, bool non_temporal = false);
+    int pr_write(int set_num, int tag, bool non_temporal = false);
+    int read_bypass(int set_num, int tag);
+    int write_bypass(int set_num, int tag);
+    long replay_hits(int set_num, int tag, bool write, long count);
     int get_status(int set_num, int tag);
     void set_status(int set_num, int tag, int new_status);
+    int invalid_status() { return Dragon_status::not_found; }
+    bool is_dirty(int status) { return status == Dragon_status::Md || status == Dragon_status::Sm; }
 };
 
 #endif // _LRU_CACHE_H
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include <climits>
+
+#include "memory.h"
+
+int FlatMemory::access(long /* addr */, long /* now */, bool /* is_write */)
+{
+    return latency;
+}
+
+DRAM::DRAM(int _num_channels, int _num_banks, int _row_size, int _block_size, SchedulingPolicy _policy,
+           int _t_cas, int _t_rcd, int _t_rp, int _t_burst)
+: channels(_num_channels)
+, num_channels(_num_channels)
+, num_banks(_num_banks)
+, blocks_per_row(std::max(1, _row_size / _block_size))
+, block_size(_block_size)
+, policy(_policy)
+, T_CAS(_t_cas)
+, T_RCD(_t_rcd)
+, T_RP(_t_rp)
+, T_BURST(_t_burst)
+{
+    for (Channel &channel : channels)
+        channel.banks.resize(num_banks);
+}
+
+int DRAM::access(long addr, long now, bool /* is_write */)
+{
+    // Consecutive blocks interleave across channels, then fill a row of a bank
+    long block = addr / block_size;
+    Channel &channel = channels[block % num_channels];
+    long channel_block = block / num_channels;
+    long row_block = channel_block / blocks_per_row;
+    long row = row_block / num_banks;
+
+    std::lock_guard<std::mutex> guard(channel.lock);
+    Bank &bank = channel.banks[row_block % num_banks];
+
+    bool row_hit = true;
+    long start;
+    long done;
+    if (row == bank.open_row)
+    {
+        start = std::max(now, bank.ready_at);
+        done = start + T_CAS;
+        bank.ready_at = done;
+    }
+    else if (policy == SchedulingPolicy::frfcfs && row == bank.closing_row && now < bank.closing_at)
+    {
+        // FR-FCFS: a hit to the row still in the buffer is served ahead of the
+        // queued activation, which slips by one column access
+        start = std::max(now, bank.closing_ready_at);
+        done = start + T_CAS;
+        bank.closing_ready_at = done;
+        bank.closing_at = std::max(bank.closing_at, done);
+        bank.ready_at += T_CAS;
+    }
+    else
+    {
+        row_hit = false;
+        start = std::max(now, bank.ready_at);
+        done = start + (bank.open_row == -1 ? 0 : T_RP) + T_RCD + T_CAS;
+        bank.closing_row = bank.open_row;
+        bank.closing_ready_at = bank.ready_at;
+        bank.closing_at = start;
+        bank.open_row = row;
+        bank.ready_at = done;
+    }
+
+    // The block then occupies the channel's data bus
+    long transfer = std::max(done, channel.bus_ready_at);
+    channel.bus_ready_at = transfer + T_BURST;
+    long latency = channel.bus_ready_at - now;
+
+    std::lock_guard<std::mutex> stats_guard(stats_lock);
+    ++count_access;
+    if (row_hit)
+        ++count_row_hit;
+    total_latency += latency;
+    total_queue_delay += start - now;
+    return (int)std::min<long>(latency, INT_MAX);
+}
@@ -0,0 +1,84 @@
+#ifndef _MEMORY_H
+#define _MEMORY_H
+
+/**
+ * Memory
+ * Backend behind the bus that serves block fetches and write-backs.
+ * FlatMemory charges the same latency to every access.
+ * DRAM models channels and banks with open row buffers. Each bank and each
+ * channel's data bus is busy until its last scheduled access completes, so
+ * accesses from all cores queue behind each other. Time is the requesting
+ * core's local clock, which is only comparable across cores when the engine
+ * runs with a quantum.
+*/
+
+#include <mutex>
+#include <vector>
+
+#include "config.h"
+
+class Memory {
+public:
+    // Statistics
+    long count_access = 0;
+    long count_row_hit = 0;
+    long total_latency = 0;
+    long total_queue_delay = 0;
+
+    // Returns the latency of an access to the block at addr issued at cycle now
+    virtual int access(long addr, long now, bool is_write) = 0;
+    virtual bool is_dram() = 0;
+};
+
+class FlatMemory : public Memory {
+public:
+    int latency;
+
+    FlatMemory(int _latency)
+    : latency(_latency)
+    {}
+    int access(long addr, long now, bool is_write);
+    bool is_dram() { return false; }
+};
+
+struct Bank {
+    long open_row = -1;      // row open once every scheduled access is done
+    long ready_at = 0;       // when the bank finishes every scheduled access
+    // The previously open row stays in the row buffer until the queued
+    // activation of open_row starts at closing_at
+    long closing_row = -1;
+    long closing_at = 0;
+    long closing_ready_at = 0;
+};
+
+struct Channel {
+    std::mutex lock;
+    long bus_ready_at = 0;
+    std::vector<Bank> banks;
+};
+
+class DRAM : public Memory {
+private:
+    std::vector<Channel> channels;
+    int num_channels;
+    int num_banks;
+    int blocks_per_row;
+    int block_size;
+    SchedulingPolicy policy;
+
+    // Timing in processor cycles
+    int T_CAS;   // column access
+    int T_RCD;   // row activation
+    int T_RP;    // precharge
+    int T_BURST; // data transfer of one block
+
+    std::mutex stats_lock;
+
+public:
+    DRAM(int _num_channels, int _num_banks, int _row_size, int _block_size, SchedulingPolicy _policy,
+         int _t_cas, int _t_rcd, int _t_rp, int _t_burst);
+    int access(long addr, long now, bool is_write);
+    bool is_dram() { return true; }
+};
+
+#endif // _MEMORY_H
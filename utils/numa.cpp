@@ -0,0 +1,61 @@
+#include "numa.h"
+
+int Numa::home_of(long addr, int pid)
+{
+    long page = addr / page_size;
+    if (policy == NumaPolicy::interleave)
+        return page % num_sockets;
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = homes.find(page);
+    if (it != homes.end())
+        return it->second;
+    int home = socket_of(pid);
+    homes[page] = home;
+    return home;
+}
+
+int Numa::memory(int pid, long addr)
+{
+    if (home_of(addr, pid) == socket_of(pid))
+    {
+        ++stats[pid].local_memory;
+        return 0;
+    }
+    ++stats[pid].remote_memory;
+    return remote_memory;
+}
+
+void Numa::transfer(int pid, int supplier)
+{
+    if (socket_of(supplier) == socket_of(pid))
+    {
+        ++stats[pid].local_transfer;
+        return;
+    }
+    ++stats[pid].remote_transfer;
+    stats[pid].pending_cycles += remote_transfer;
+}
+
+void Numa::snoop(int pid, int other)
+{
+    if (socket_of(other) == socket_of(pid))
+        return;
+    ++stats[pid].remote_snoop;
+    stats[pid].pending_cycles += remote_snoop;
+}
+
+void Numa::leave_socket(int pid, int other, bool& looked_up)
+{
+    if (looked_up || socket_of(other) == socket_of(pid))
+        return;
+    looked_up = true;
+    ++stats[pid].directory_lookups;
+    stats[pid].pending_cycles += directory;
+}
+
+long Numa::take_cycles(int pid)
+{
+    long cycles = stats[pid].pending_cycles;
+    stats[pid].pending_cycles = 0;
+    return cycles;
+}
@@ -0,0 +1,77 @@
+#ifndef _NUMA_H
+#define _NUMA_H
+
+/**
+ * NUMA Sockets
+ * Cores are split into sockets of consecutive pids. A request snoops its own
+ * socket's caches first; one that has to reach another socket, a read that no
+ * local cache supplies or a write that invalidates or updates a remote copy,
+ * first pays a directory lookup at the home agent. The directory is only a
+ * cost: there is no directory state, and every cache still sits on the one
+ * snoop bus. Crossing sockets also adds a penalty to cache-to-cache
+ * transfers, to every remote invalidation or update and to memory accesses
+ * whose page lives on another socket. Pages are placed on the socket of the
+ * first core that touches them or interleaved across sockets.
+*/
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "config.h"
+
+struct alignas(64) NumaStats {
+    std::atomic<long> local_memory = 0;
+    std::atomic<long> remote_memory = 0;
+    long local_transfer = 0;
+    long remote_transfer = 0;
+    long remote_snoop = 0;
+    long directory_lookups = 0;
+    long pending_cycles = 0; // penalties of the current access, only touched by the core itself
+};
+
+class Numa {
+private:
+    std::mutex lock;
+    std::unordered_map<long, int> homes; // page -> socket, first-touch only
+
+public:
+    int num_sockets;
+    int num_cores;
+    NumaPolicy policy;
+    long page_size;
+    int remote_memory;   // extra cycles of a memory access to another socket
+    int remote_transfer; // extra cycles of a block sent from another socket
+    int remote_snoop;    // extra cycles per invalidation or update of another socket
+    int directory;       // cycles of the home agent lookup of a request leaving its socket
+    std::vector<NumaStats> stats;
+
+    Numa(int _num_sockets, int _num_cores, NumaPolicy _policy, long _page_size, int _remote_memory, int _remote_transfer, int _remote_snoop, int _directory)
+    : num_sockets(_num_sockets)
+    , num_cores(_num_cores)
+    , policy(_policy)
+    , page_size(_page_size)
+    , remote_memory(_remote_memory)
+    , remote_transfer(_remote_transfer)
+    , remote_snoop(_remote_snoop)
+    , directory(_directory)
+    , stats(_num_cores)
+    {}
+
+    int socket_of(int pid) { return (long)pid * num_sockets / num_cores; }
+    // Socket whose memory holds addr, placing the page on first touch by pid
+    int home_of(long addr, int pid);
+    // Returns the extra cycles of a memory access by pid
+    int memory(int pid, long addr);
+    // Charges a block sent from supplier to pid, or a snoop of supplier's copy
+    void transfer(int pid, int supplier);
+    void snoop(int pid, int other);
+    // Charges the directory lookup the first time a request of pid reaches
+    // other in another socket, looked_up tracks it for the request
+    void leave_socket(int pid, int other, bool& looked_up);
+    // Returns and clears the penalties pid accumulated since the last call
+    long take_cycles(int pid);
+};
+
+#endif // _NUMA_H
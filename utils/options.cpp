@@ -0,0 +1,293 @@
+#include "options.h"
+
+#include <iostream>
+
+namespace {
+
+// Parses a byte count with an optional K, M or G suffix
+long parse_size(const std::string& value)
+{
+    size_t end;
+    long size = std::stol(value, &end);
+    std::string suffix = value.substr(end);
+    if (suffix == "K" || suffix == "k")
+        size <<= 10;
+    else if (suffix == "M" || suffix == "m")
+        size <<= 20;
+    else if (suffix == "G" || suffix == "g")
+        size <<= 30;
+    else if (!suffix.empty())
+        throw std::invalid_argument(value);
+    return size;
+}
+
+}
+
+bool Options::parse(const std::string& arg)
+{
+    if (arg.rfind("--", 0) != 0)
+        return false;
+    size_t eq = arg.find('=');
+    std::string key = arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2);
+    std::string value = eq == std::string::npos ? "1" : arg.substr(eq + 1);
+
+    try
+    {
+        if (key == "cores")
+            cores = std::stoi(value);
+        else if (key == "validate")
+            validate = std::stoi(value) != 0;
+        else if (key == "streaming-stores")
+            streaming_stores = std::stoi(value) != 0;
+        else if (key == "store-buffer")
+            store_buffer = std::stoi(value);
+        else if (key == "victim")
+            victim_entries = std::stoi(value);
+        else if (key == "collapse")
+            collapse = std::stoi(value) != 0;
+        else if (key == "sched")
+        {
+            if (value == "none")
+                sched = SchedulingMode::one_per_core;
+            else if (value == "pinned")
+                sched = SchedulingMode::pinned;
+            else if (value == "round-robin")
+                sched = SchedulingMode::round_robin;
+            else if (value == "affinity")
+                sched = SchedulingMode::affinity;
+            else
+                return false;
+        }
+        else if (key == "sw-threads")
+            sw_threads = std::stoi(value);
+        else if (key == "time-slice")
+            time_slice = std::stol(value);
+        else if (key == "sockets")
+            sockets = std::stoi(value);
+        else if (key == "numa-policy")
+        {
+            if (value == "first-touch")
+                numa_policy = NumaPolicy::first_touch;
+            else if (value == "interleave")
+                numa_policy = NumaPolicy::interleave;
+            else
+                return false;
+        }
+        else if (key == "numa-page")
+            numa_page_size = parse_size(value);
+        else if (key == "latency")
+            return latency.load(value);
+        else if (key == "hybrid-threshold")
+        {
+            // Counted in 4 bits of each cache line
+            hybrid_threshold = std::stoi(value);
+            if (hybrid_threshold < 1 || hybrid_threshold > 15)
+                return false;
+        }
+        else if (key == "syn-accesses")
+            synthetic.accesses = std::stol(value);
+        else if (key == "syn-working-set")
+            synthetic.working_set = parse_size(value);
+        else if (key == "syn-read-ratio")
+            synthetic.read_ratio = std::stod(value);
+        else if (key == "syn-sharing")
+            synthetic.sharing = std::stod(value);
+        else if (key == "syn-pattern")
+        {
+            if (value == "uniform")
+                synthetic.pattern = SyntheticPattern::uniform;
+            else if (value == "producer-consumer")
+                synthetic.pattern = SyntheticPattern::producer_consumer;
+            else if (value == "migratory")
+                synthetic.pattern = SyntheticPattern::migratory;
+            else if (value == "false-sharing")
+                synthetic.pattern = SyntheticPattern::false_sharing;
+            else
+                return false;
+        }
+        else if (key == "syn-access")
+        {
+            if (value == "stride")
+                synthetic.random_access = false;
+            else if (value == "random")
+                synthetic.random_access = true;
+            else
+                return false;
+        }
+        else if (key == "syn-stride")
+            synthetic.stride = parse_size(value);
+        else if (key == "syn-compute")
+            synthetic.compute = std::stol(value);
+        else if (key == "syn-seed")
+            synthetic.seed = std::stoull(value);
+        else if (key == "interval")
+            interval_accesses = std::stol(value);
+        else if (key == "interval-cycles")
+            interval_cycles = std::stol(value);
+        else if (key == "events")
+            events = value;
+        else if (key == "quantum")
+            quantum = std::stol(value);
+        else if (key == "threads")
+            threads = std::stoi(value);
+        else if (key == "cache")
+            cache = std::stoi(value) != 0;
+        else if (key == "page-size")
+            page_size = parse_size(value);
+        else if (key == "tlb-entries")
+            tlb_entries = std::stoi(value);
+        else if (key == "tlb-assoc")
+            tlb_associativity = std::stoi(value);
+        else if (key == "tlb-miss-latency")
+            tlb_miss_latency = std::stoi(value);
+        else if (key == "memory")
+        {
+            if (value == "flat")
+                dram = false;
+            else if (value == "dram")
+                dram = true;
+            else
+                return false;
+        }
+        else if (key == "dram-channels")
+            dram_channels = std::stoi(value);
+        else if (key == "dram-banks")
+            dram_banks = std::stoi(value);
+        else if (key == "dram-row-size")
+            dram_row_size = parse_size(value);
+        else if (key == "dram-policy")
+        {
+            if (value == "fcfs")
+                dram_policy = SchedulingPolicy::fcfs;
+            else if (value == "frfcfs")
+                dram_policy = SchedulingPolicy::frfcfs;
+            else
+                return false;
+        }
+        else if (key == "page-policy")
+        {
+            if (value == "sequential")
+                page_policy = PagePolicy::sequential;
+            else if (value == "random")
+                page_policy = PagePolicy::randomized;
+            else if (value == "coloring")
+                page_policy = PagePolicy::coloring;
+            else
+                return false;
+        }
+        else
+            return false;
+    }
+    catch (...)
+    {
+        return false;
+    }
+    return cores >= 0 && quantum >= 0 && interval_accesses >= 0 && interval_cycles >= 0 && threads >= 0
+        && synthetic.accesses >= 0 && synthetic.working_set >= 4 && synthetic.stride >= 0 && synthetic.compute >= 0 && page_size >= 0
+        && tlb_entries > 0 && tlb_associativity > 0 && tlb_miss_latency >= 0
+        && dram_channels > 0 && dram_banks > 0 && dram_row_size > 0;
+}
+
+std::string Options::describe()
+{
+    std::string s;
+    s += "cores=" + std::to_string(cores) + ";";
+    s += "syn-accesses=" + std::to_string(synthetic.accesses) + ";";
+    s += "syn-working-set=" + std::to_string(synthetic.working_set) + ";";
+    s += "syn-read-ratio=" + std::to_string(synthetic.read_ratio) + ";";
+    s += "syn-sharing=" + std::to_string(synthetic.sharing) + ";";
+    s += "syn-pattern=" + std::to_string(synthetic.pattern) + ";";
+    s += "syn-access=" + std::to_string(synthetic.random_access) + ";";
+    s += "syn-stride=" + std::to_string(synthetic.stride) + ";";
+    s += "syn-compute=" + std::to_string(synthetic.compute) + ";";
+    s += "syn-seed=" + std::to_string(synthetic.seed) + ";";
+    s += "interval=" + std::to_string(interval_accesses) + ";";
+    s += "interval-cycles=" + std::to_string(interval_cycles) + ";";
+    s += "streaming-stores=" + std::to_string(streaming_stores) + ";";
+    s += "store-buffer=" + std::to_string(store_buffer) + ";";
+    s += "victim=" + std::to_string(victim_entries) + ";";
+    s += "collapse=" + std::to_string(collapse) + ";";
+    s += "hybrid-threshold=" + std::to_string(hybrid_threshold) + ";";
+    s += "sched=" + std::to_string(sched) + ";";
+    if (sched != SchedulingMode::one_per_core)
+    {
+        s += "sw-threads=" + std::to_string(sw_threads) + ";";
+        s += "time-slice=" + std::to_string(time_slice) + ";";
+    }
+    s += "sockets=" + std::to_string(sockets) + ";";
+    if (sockets > 1)
+    {
+        s += "numa-policy=" + std::to_string(numa_policy) + ";";
+        s += "numa-page=" + std::to_string(numa_page_size) + ";";
+    }
+    s += latency.describe();
+    s += "quantum=" + std::to_string(quantum) + ";";
+    s += "threads=" + std::to_string(threads) + ";";
+    s += "page-size=" + std::to_string(page_size) + ";";
+    if (page_size > 0)
+    {
+        s += "tlb-entries=" + std::to_string(tlb_entries) + ";";
+        s += "tlb-assoc=" + std::to_string(tlb_associativity) + ";";
+        s += "tlb-miss-latency=" + std::to_string(tlb_miss_latency) + ";";
+        s += "page-policy=" + std::to_string(page_policy) + ";";
+    }
+    s += "memory=" + std::string(dram ? "dram" : "flat") + ";";
+    if (dram)
+    {
+        s += "dram-channels=" + std::to_string(dram_channels) + ";";
+        s += "dram-banks=" + std::to_string(dram_banks) + ";";
+        s += "dram-row-size=" + std::to_string(dram_row_size) + ";";
+        s += "dram-policy=" + std::to_string(dram_policy) + ";";
+    }
+    return s;
+}
+
+void Options::print_usage()
+{
+    std::cout << "Options (append to any syntax):" << std::endl;
+    std::cout << "  --cores=<n>         Number of simulated cores (default 4, or one per trace of a manifest)" << std::endl;
+    std::cout << "  --validate=0        Skip the up-front scan of the traces" << std::endl;
+    std::cout << "Synthetic benchmark (<BENCHMARK> = synthetic):" << std::endl;
+    std::cout << "  --syn-accesses=<n>  Memory accesses per core (default 1000000)" << std::endl;
+    std::cout << "  --syn-working-set=<bytes>  Size of the shared and of each private region (default 64K)" << std::endl;
+    std::cout << "  --syn-read-ratio=<0..1>  Fraction of reads (default 0.7)" << std::endl;
+    std::cout << "  --syn-sharing=<0..1>  Fraction of accesses to shared data, uniform pattern (default 0.1)" << std::endl;
+    std::cout << "  --syn-pattern=<uniform|producer-consumer|migratory|false-sharing>" << std::endl;
+    std::cout << "  --syn-access=<stride|random>  Address sequence within a region (default stride)" << std::endl;
+    std::cout << "  --syn-stride=<bytes>  Stride of the strided walk (default 4)" << std::endl;
+    std::cout << "  --syn-compute=<cycles>  Mean compute gap between accesses (default 10)" << std::endl;
+    std::cout << "  --syn-seed=<n>      Generator seed (default 1)" << std::endl;
+    std::cout << "Simulation:" << std::endl;
+    std::cout << "  --quantum=<cycles>  Run cores in lockstep windows of <cycles> simulated cycles (0 = free-running)" << std::endl;
+    std::cout << "  --threads=<n>       Host threads used with --quantum; 1 gives a deterministic sequential run" << std::endl;
+    std::cout << "  --streaming-stores  Treat every store as non-temporal: a store miss writes through without allocating" << std::endl;
+    std::cout << "  --store-buffer=<n>  Per-core store buffer entries; fences and atomic read-modify-writes drain it (default 0 = off)" << std::endl;
+    std::cout << "  --victim=<n>        Per-core fully associative victim cache lines, checked on a miss before the bus (default 0 = off)" << std::endl;
+    std::cout << "  --collapse          Replay consecutive hits to the same block as one step (approximate: no snoops in between)" << std::endl;
+    std::cout << "  --sched=<none|pinned|round-robin|affinity>  Time-share software threads (one per trace) over the cores (default none)" << std::endl;
+    std::cout << "  --sw-threads=<n>    Software threads with --sched (default one per trace of a manifest, otherwise one per core)" << std::endl;
+    std::cout << "  --time-slice=<cycles>  Cycles a thread runs before the core reschedules (default 100000)" << std::endl;
+    std::cout << "  --sockets=<n>       Split the cores into NUMA sockets; requests leaving a socket pay a directory lookup (default 1)" << std::endl;
+    std::cout << "  --numa-policy=<first-touch|interleave>  Placement of pages on sockets (default first-touch)" << std::endl;
+    std::cout << "  --numa-page=<bytes> Placement granularity (default 4K)" << std::endl;
+    std::cout << "  --latency=<file>    Hit, word transfer, invalidation, memory and word size cycles as key = value lines," << std::endl;
+    std::cout << "                      core.<n>.<key> = value for one core (default 1, 2, 2, 100 and 4 bytes);" << std::endl;
+    std::cout << "                      remote-memory, remote-transfer, remote-snoop and remote-directory add to accesses across sockets" << std::endl;
+    std::cout << "                      (default 60, 40, 40, 20)" << std::endl;
+    std::cout << "                      dram-cas, dram-rcd, dram-rp and dram-burst time --memory=dram (default 30, 30, 30, 10)" << std::endl;
+    std::cout << "  --hybrid-threshold=<n>  Updates a Hybrid copy receives without a local access before it self-invalidates (1-15, default 4)" << std::endl;
+    std::cout << "  --page-size=<4K|2M> Translate trace addresses through a TLB and page table before indexing" << std::endl;
+    std::cout << "  --tlb-entries=<n>   TLB entries per core (default 64)" << std::endl;
+    std::cout << "  --tlb-assoc=<n>     TLB associativity (default 4)" << std::endl;
+    std::cout << "  --tlb-miss-latency=<cycles>  Page walk penalty (default 30)" << std::endl;
+    std::cout << "  --page-policy=<sequential|random|coloring>  Physical frame allocation (default sequential)" << std::endl;
+    std::cout << "  --memory=<flat|dram>  Memory behind the bus: flat 100 cycles or a banked DRAM (default flat); dram needs --quantum" << std::endl;
+    std::cout << "  --dram-channels=<n> DRAM channels (default 2)" << std::endl;
+    std::cout << "  --dram-banks=<n>    Banks per channel (default 8)" << std::endl;
+    std::cout << "  --dram-row-size=<bytes>  Row buffer size (default 2K)" << std::endl;
+    std::cout << "  --dram-policy=<fcfs|frfcfs>  Bank scheduling policy (default frfcfs)" << std::endl;
+    std::cout << "  --interval=<n>      Write per-core statistics every <n> accesses to <log>.intervals.csv" << std::endl;
+    std::cout << "  --interval-cycles=<n>  Same, every <n> simulated cycles" << std::endl;
+    std::cout << "  --events=<path>     Write every coherence state transition to a binary event trace" << std::endl;
+    std::cout << "  --cache             Skip the run if results/ already holds it for the same binary, traces and configuration" << std::endl;
+}
@@ -0,0 +1,78 @@
+#ifndef _OPTIONS_H
+#define _OPTIONS_H
+
+/**
+ * Options
+ * Optional settings passed after the positional arguments as --key=value.
+ * Every option defaults to the behaviour of the original simulator.
+*/
+
+#include <string>
+
+#include "config.h"
+#include "latency.h"
+#include "trace.h"
+
+class Options {
+public:
+    int cores = 0; // 0 = one per trace of a manifest, otherwise 4
+    bool validate = true; // scan every trace before simulating
+    bool streaming_stores = false; // every store bypasses the cache on a miss
+    int store_buffer = 0; // entries per core, 0 = stores block the core
+    int victim_entries = 0; // fully associative victim cache lines per core, 0 = off
+    bool collapse = false; // fold consecutive hits to the same block into one step
+    int hybrid_threshold = 4; // unused updates before a Hybrid copy self-invalidates
+
+    // Software threads, one_per_core = trace i runs on core i for the whole run
+    SchedulingMode sched = SchedulingMode::one_per_core;
+    int sw_threads = 0;        // 0 = one per trace of a manifest, otherwise one per core
+    long time_slice = 100000;  // simulated cycles
+
+    // NUMA sockets, 1 = a single bus and a uniform memory
+    int sockets = 1;
+    NumaPolicy numa_policy = NumaPolicy::first_touch;
+    long numa_page_size = 4096;
+
+    // Cache, bus and flat memory timing, loaded from --latency=<file>
+    LatencyConfig latency;
+
+    // Interval statistics, 0 = off
+    long interval_accesses = 0;
+    long interval_cycles = 0;
+
+    // Coherence event trace, empty = off
+    std::string events;
+
+    // Synthetic benchmark
+    SyntheticConfig synthetic;
+
+    // Parallel engine
+    long quantum = 0;  // simulated cycles per synchronization window, 0 = free-running threads
+    int threads = 0;   // host threads for the quantum engine, 0 = one per core up to the host's cores
+
+    // Results cache
+    bool cache = false; // reuse results/ logs whose binary, traces and configuration are unchanged
+
+    // Address translation
+    long page_size = 0; // bytes, 0 = caches are indexed with the trace addresses directly
+    int tlb_entries = 64;
+    int tlb_associativity = 4;
+    int tlb_miss_latency = 30;
+    PagePolicy page_policy = PagePolicy::sequential;
+
+    // Memory behind the bus
+    bool dram = false; // false = flat 100 cycle memory
+    int dram_channels = 2;
+    int dram_banks = 8;
+    long dram_row_size = 2048;
+    SchedulingPolicy dram_policy = SchedulingPolicy::frfcfs;
+
+    // Returns false if the option is unknown or its value is malformed
+    // A bare --key is shorthand for --key=1
+    bool parse(const std::string& arg);
+    // Canonical key=value list of every option, used to key the results cache
+    std::string describe();
+    static void print_usage();
+};
+
+#endif // _OPTIONS_H
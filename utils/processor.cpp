@@ -1,73 +1,341 @@
 #include "processor.h"
+#include "bus.h"
 
 #include <sstream>
 #include <string>
 
+std::string Processor::trace_path(Benchmark benchmark, int pid) {
+    std::string path;
+    if (benchmark == Benchmark::blackscholes)
+    {
+        path = "blackscholes_four/blackscholes_";
+    }
+    else if (benchmark == Benchmark::bodytrack)
+    {
+        path = "bodytrack_four/bodytrack_";
+    }
+    else
+    {
+        path = "fluidanimate_four/fluidanimate_";
+    }
+    return path + std::to_string(pid) + ".data";
+}
+
+void Processor::init_tlb(TLB* _tlb) {
+    tlb = _tlb;
+}
+
+void Processor::init_intervals(IntervalRecorder* _intervals) {
+    intervals = _intervals;
+}
+
+IntervalRecorder* Processor::get_intervals() {
+    return intervals;
+}
+
+void Processor::init_latency(const Latency& _latency) {
+    cache->latency = _latency;
+}
+
+void Processor::init_victim_cache(VictimCache* _victim) {
+    cache->victim = _victim;
+}
+
+void Processor::init_scheduler(Scheduler* _scheduler) {
+    scheduler = _scheduler;
+}
+
+Scheduler* Processor::get_scheduler() {
+    return scheduler;
+}
+
+// Hands the current software thread back and takes the next one,
+// returns false if no thread is ready for this core
+bool Processor::switch_thread(bool finished) {
+    thread = scheduler->next(pid, thread, finished);
+    if (thread == nullptr)
+        return false;
+    trace = thread->trace;
+    slice_end = get_clock() + scheduler->time_slice;
+    return true;
+}
+
+void Processor::init_store_buffer(StoreBuffer* _store_buffer) {
+    store_buffer = _store_buffer;
+}
+
+StoreBuffer* Processor::get_store_buffer() {
+    return store_buffer;
+}
+
+const AtomicStats& Processor::get_atomic_stats() {
+    return atomic_stats;
+}
+
+// Snapshot of the cumulative counters sampled by the interval statistics
+IntervalSample Processor::sample() {
+    return {get_clock(), count_mem_instr, cache->count_cache_miss, cache->count_data_traffic,
+            cache->count_update, idle_cycle};
+}
+
 LRUCache* Processor::get_cache() {
     return cache;
 }
 
+TLB* Processor::get_tlb() {
+    return tlb;
+}
+
 long Processor::get_total_cycle() {
     return total_cycle;
 }
 
-int Processor::get_compute_cycle() {
+long Processor::get_compute_cycle() {
     return compute_cycle;
 }
 
-int Processor::get_count_mem_instr() {
+long Processor::get_count_mem_instr() {
     return count_mem_instr;
 }
 
-int Processor::get_idle_cycle() {
+long Processor::get_count_collapsed() {
+    return count_collapsed;
+}
+
+long Processor::get_idle_cycle() {
     return idle_cycle;
 }
 
-int Processor::get_count_cache_miss()
+long Processor::get_count_cache_miss()
 {
     return cache->count_cache_miss;
 }
-int Processor::get_count_data_traffic()
+long Processor::get_count_data_traffic()
 {
     return cache->count_data_traffic;
 }
-int Processor::get_count_update()
+long Processor::get_count_update()
 {
     return cache->count_update;
 }
-int Processor::get_count_private_access()
+long Processor::get_count_private_access()
 {
     return cache->count_private_access;
 }
-int Processor::get_count_shared_access()
+long Processor::get_count_shared_access()
 {
     return cache->count_shared_access;
 }
 
-void Processor::run() {
-    std::string str_val;
-    uint32_t label;
-    long val;
-    while (benchmark_file >> label >> str_val) {
-        val = std::stoi(str_val, nullptr, 16);
-        if (label == 0 || label == 1) {
-            count_mem_instr += 1;
-            int set_index = (val / N) % M;
-            int tag = (val / N) / M;
-            if (label == 0) { // read
-                idle_cycle += cache->pr_read(set_index, tag);      
-            } else { // write
-                idle_cycle += cache->pr_write(set_index, tag);
-            }
+// Local simulated time: compute cycles plus every stall charged to this core
+long Processor::get_clock() {
+    return compute_cycle + idle_cycle;
+}
+
+// Ordinary and non-temporal stores, through the store buffer if there is one
+int Processor::store(int set_index, int tag, bool non_temporal) {
+    int latency = cache->pr_write(set_index, tag, non_temporal);
+    if (store_buffer == nullptr)
+        return latency;
+    return cache->latency.hit + store_buffer->push(get_clock(), latency);
+}
+
+// Atomics take exclusive ownership of the block: MESI invalidates the other
+// copies through BusRd and BusUpd, Dragon broadcasts the new value
+int Processor::atomic(uint32_t label, int set_index, int tag) {
+    long found_before = cache->count_found_elsewhere;
+    int cycles = 0;
+    if (label == 5) { // read-modify-write, a full fence like x86 locked instructions
+        if (store_buffer != nullptr)
+            cycles += store_buffer->drain(get_clock());
+        cycles += cache->pr_write(set_index, tag);
+    } else if (label == 6) { // load-linked
+        cycles += cache->pr_read(set_index, tag);
+        cache->reserve(set_index, tag);
+    } else { // store-conditional, fails without a bus transaction if the reservation was lost
+        if (cache->take_reservation(set_index, tag)) {
+            cycles += cache->pr_write(set_index, tag);
+        } else {
+            ++atomic_stats.count_sc_failed;
+            cycles += cache->latency.hit; // only checks the local reservation
+        }
+    }
+    ++atomic_stats.count_atomic;
+    atomic_stats.atomic_cycles += cycles;
+    // Contended only if the bus found the block in another cache, not on a local shared hit
+    if (cache->count_found_elsewhere != found_before)
+        ++atomic_stats.count_contended;
+    return cycles;
+}
+
+bool Processor::next_record(TraceRecord& record) {
+    if (lookahead_head == lookahead.size())
+        return trace->next(record);
+    record = lookahead[lookahead_head++];
+    if (lookahead_head == lookahead.size()) {
+        lookahead.clear();
+        lookahead_head = 0;
+    }
+    if (not_collapsible > 0)
+        --not_collapsible;
+    return true;
+}
+
+// Collapsed replay: folds the reads (after a write, the reads and writes) that
+// follow to the same block, and the compute records between them, into the
+// current step while they would all hit without a bus transaction. The block
+// is assumed not to be snooped in between, the approximation traded for speed.
+void Processor::collapse_hits(uint32_t label, int set_index, int tag, long block) {
+    const size_t MAX_LOOKAHEAD = 4096;
+    if (not_collapsible > 0)
+        return;
+    if (lookahead_head > MAX_LOOKAHEAD) {
+        lookahead.erase(lookahead.begin(), lookahead.begin() + lookahead_head);
+        lookahead_head = 0;
+    }
+    long hits = 0;
+    long gap = 0;
+    long absorbed_gap = 0;
+    size_t absorbed = 0;
+    TraceRecord record;
+    for (size_t i = 0; i < MAX_LOOKAHEAD; ++i) {
+        if (lookahead_head + i == lookahead.size()) {
+            if (!trace->next(record))
+                break;
+            lookahead.push_back(record);
+        }
+        const TraceRecord &next = lookahead[lookahead_head + i];
+        if (next.label == 2) {
+            gap += next.value;
+            continue;
+        }
+        // After a write the block is dirty and private, so reads to it hit silently too
+        if ((next.label != label && !(label == 1 && next.label == 0)) || next.value / N != block)
+            break;
+        ++hits;
+        absorbed = i + 1;
+        absorbed_gap = gap;
+    }
+    if (hits == 0)
+        return;
+    long cycles = cache->replay_hits(set_index, tag, label == 1, hits);
+    if (cycles < 0) {
+        // Not a silent hit, e.g. a write to a shared Dragon copy: run them one by one
+        not_collapsible = absorbed;
+        return;
+    }
+    lookahead_head += absorbed;
+    if (lookahead_head == lookahead.size()) {
+        lookahead.clear();
+        lookahead_head = 0;
+    }
+    count_mem_instr += hits;
+    count_collapsed += hits;
+    compute_cycle += absorbed_gap;
+    // Matches step(), which adds the idle cycles so far to total_cycle after every access
+    long idle = idle_cycle;
+    long hit = cycles / hits;
+    total_cycle += absorbed_gap + hits * idle + hit * hits * (hits + 1) / 2;
+    idle_cycle += cycles;
+    if (thread != nullptr) {
+        thread->accesses += hits;
+        if (thread->migrated)
+            thread->migrated_accesses += hits;
+    }
+}
+
+// Executes the next trace record, returns false once the trace is exhausted
+bool Processor::step() {
+    TraceRecord record;
+    if (scheduler != nullptr && !done && lookahead_head == lookahead.size() && (thread == nullptr || get_clock() >= slice_end))
+        done = !switch_thread(false);
+    while (!done && !next_record(record)) {
+        if (scheduler == nullptr || !switch_thread(true))
+            done = true;
+    }
+    if (done)
+        return false;
+    uint32_t label = record.label;
+    long val = record.value;
+    if (label == 8) { // fence
+        ++atomic_stats.count_fence;
+        if (store_buffer != nullptr) {
+            long stall = store_buffer->drain(get_clock());
+            atomic_stats.fence_stall_cycles += stall;
+            idle_cycle += stall;
             total_cycle += idle_cycle;
+        }
+    } else if (label != 2 && label <= MAX_LABEL) {
+        count_mem_instr += 1;
+        if (tlb != nullptr) {
+            long cycles = 0;
+            val = tlb->translate(val, cycles);
+            idle_cycle += cycles;
+        }
+        int set_index = (val / N) % M;
+        int tag = (val / N) / M;
+        EventTracer *events = bus->events;
+        long clock = 0;
+        if (events) {
+            events->pending[pid] = PendingAccess();
+            clock = get_clock();
+        }
+        long misses_before = cache->count_cache_miss;
+        int cycles;
+        if (label == 0 || label == 3) { // read
+            cycles = cache->pr_read(set_index, tag, label == 3);
+        } else if (label == 1 || label == 4) { // write
+            cycles = store(set_index, tag, label == 4 || streaming_stores);
         } else {
-            if (label != 2) {
-                std::cout << "[ERROR] label index value goes out of range." << std::endl;
-                return;
+            cycles = atomic(label, set_index, tag);
+        }
+        if (bus->numa)
+            cycles += bus->numa->take_cycles(pid);
+        idle_cycle += cycles;
+        total_cycle += idle_cycle;
+        if (thread != nullptr) {
+            long misses = cache->count_cache_miss - misses_before;
+            ++thread->accesses;
+            thread->misses += misses;
+            if (thread->migrated) {
+                ++thread->migrated_accesses;
+                thread->migrated_misses += misses;
             }
-            compute_cycle += val;
-            total_cycle += val;
         }
-    }     
+        if (events) {
+            // The cache captured the transition while it held the set lock
+            const PendingAccess &pending = events->pending[pid];
+            CoherenceEvent event = {};
+            event.cycle = clock;
+            event.addr = bus->block_address(set_index, tag);
+            event.latency = cycles;
+            event.core = pid;
+            event.requester = pid;
+            event.old_state = pending.old_state;
+            event.new_state = pending.new_state;
+            event.bus_op = pending.bus_op;
+            // Hits that leave the block's state unchanged are not transitions
+            if (pending.started && (event.old_state != event.new_state || event.bus_op != BusOp::no_bus_op))
+                events->record(pid, event);
+        }
+        // Stores through a store buffer and translated addresses run one by one
+        if (collapse && tlb == nullptr && (label == 0 || (label == 1 && store_buffer == nullptr)))
+            collapse_hits(label, set_index, tag, val / N);
+    } else {
+        if (label != 2) {
+            std::cout << "[ERROR] label index value goes out of range." << std::endl;
+            done = true;
+            return false;
+        }
+        compute_cycle += val;
+        total_cycle += val;
+    }
+    if (intervals != nullptr && intervals->due(count_mem_instr, get_clock()))
+        intervals->record(sample());
+    return true;
+}
+
+void Processor::run() {
+    while (step()) {}
     return; 
-}
\ No newline at end of file
+}
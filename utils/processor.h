@@ -2,37 +2,75 @@
 #define _PROCESSOR_H
 
 #include <atomic>
-#include <fstream>
 #include <string>
+#include <vector>
 #include <iostream>
 
 #include "config.h"
+#include "interval_stats.h"
 #include "lru_cache.h"
+#include "scheduler.h"
+#include "store_buffer.h"
+#include "tlb.h"
+#include "trace.h"
+
+struct AtomicStats {
+    long count_atomic = 0;       // read-modify-writes, load-linked and store-conditional
+    long atomic_cycles = 0;      // including the store buffer drain
+    long count_contended = 0;    // the block was held by another cache
+    long count_sc_failed = 0;
+    long count_fence = 0;
+    long fence_stall_cycles = 0;
+};
 
 class Processor {
 private:
-    std::ifstream benchmark_file;
+    TraceSource* trace;
+    bool done = false;
     int N;
     int M;
     int pid;
     LRUCache* cache;
     Bus* bus;
     GlobalLock* gl;
+    TLB* tlb = nullptr;
+    IntervalRecorder* intervals = nullptr;
+    StoreBuffer* store_buffer = nullptr;
+    AtomicStats atomic_stats;
+    Scheduler* scheduler = nullptr;
+    SoftwareThread* thread = nullptr;
+    long slice_end = 0;
+
+    // Records read ahead by the collapsed replay and not executed yet
+    std::vector<TraceRecord> lookahead;
+    size_t lookahead_head = 0; // next record of lookahead to execute
+    size_t not_collapsible = 0; // leading lookahead records that failed to collapse
+
+    bool switch_thread(bool finished);
+    bool next_record(TraceRecord& record);
+    void collapse_hits(uint32_t label, int set_index, int tag, long block);
+
+    int store(int set_index, int tag, bool non_temporal);
+    int atomic(uint32_t label, int set_index, int tag);
 
     // Statistics
     long total_cycle = 0;
     long compute_cycle = 0;
     long count_mem_instr = 0;
+    long count_collapsed = 0;
 
 public:
     std::atomic<long> idle_cycle = 0;
+    bool streaming_stores = false; // treat every store as non-temporal
+    bool collapse = false; // fold consecutive hits to the same block into one step
 
-    Processor(int _pid, Protocol _protocol, Benchmark _benchmark, int _cache_size, int _associativity, int _block_size, Bus* _bus, GlobalLock* _gl)
-    : pid(_pid)
+    Processor(int _pid, Protocol _protocol, TraceSource* _trace, int _cache_size, int _associativity, int _block_size, Bus* _bus, GlobalLock* _gl)
+    : trace(_trace)
+    , N(_block_size)
+    , M((_cache_size/_block_size) / _associativity)
+    , pid(_pid)
     , bus(_bus)
     , gl(_gl)
-    , M((_cache_size/_block_size) / _associativity)
-    , N(_block_size)
     {
         if (_protocol == Protocol::MESI)
         {
@@ -43,22 +81,6 @@ public:
             cache = new Dragon_Cache(_cache_size, _associativity, _block_size, _pid, _bus, _gl);
         }
 
-        std::string path;
-        if (_benchmark == Benchmark::blackscholes)
-        {
-            path = "blackscholes_four/blackscholes_";
-        }
-        else if (_benchmark == Benchmark::bodytrack)
-        {
-            path = "bodytrack_four/bodytrack_";
-        }
-        else
-        {
-            path = "fluidanimate_four/fluidanimate_";
-        }
-        path += std::to_string(pid) + ".data";
-        benchmark_file.open(path, std::ifstream::in);
-
         if (_cache_size % _block_size != 0)
         {
             std::cout << "ERROR: Cache size must be divisible by block size." << std::endl;
@@ -68,17 +90,33 @@ public:
             std::cout << "ERROR: Total number of cache block must be divisible by associativity." << std::endl;
         }
     }
+    static std::string trace_path(Benchmark benchmark, int pid);
+    void init_tlb(TLB* _tlb);
+    void init_intervals(IntervalRecorder* _intervals);
+    void init_store_buffer(StoreBuffer* _store_buffer);
+    void init_latency(const Latency& _latency);
+    void init_victim_cache(VictimCache* _victim);
+    void init_scheduler(Scheduler* _scheduler);
+    Scheduler* get_scheduler();
+    StoreBuffer* get_store_buffer();
+    const AtomicStats& get_atomic_stats();
+    IntervalRecorder* get_intervals();
+    IntervalSample sample();
     LRUCache* get_cache();
+    TLB* get_tlb();
+    bool step();
     void run();
+    long get_clock();
     long get_total_cycle();
-    int get_compute_cycle();
-    int get_count_mem_instr();
-    int get_idle_cycle();
-    int get_count_cache_miss();
-    int get_count_data_traffic();
-    int get_count_update();
-    int get_count_private_access();
-    int get_count_shared_access();
+    long get_compute_cycle();
+    long get_count_mem_instr();
+    long get_count_collapsed();
+    long get_idle_cycle();
+    long get_count_cache_miss();
+    long get_count_data_traffic();
+    long get_count_update();
+    long get_count_private_access();
+    long get_count_shared_access();
 };
 
 #endif // _PROCESSOR_H
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "results_cache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+const uint64_t FNV_OFFSET = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+uint64_t fnv1a(const char* data, size_t length, uint64_t hash = FNV_OFFSET)
+{
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t fnv1a(const std::string& s, uint64_t hash = FNV_OFFSET)
+{
+    return fnv1a(s.data(), s.size(), hash);
+}
+
+}
+
+ResultsCache::ResultsCache(std::string configuration, std::vector<std::string> inputs)
+{
+    // The binary identifies the simulator version
+    std::string binary = std::filesystem::read_symlink("/proc/self/exe").string();
+    key = hash_file(binary);
+    key = fnv1a(configuration, key);
+    for (const std::string& input : inputs)
+    {
+        key = fnv1a(input, key);
+        uint64_t content = hash_file(input);
+        key = fnv1a((const char*)&content, sizeof(content), key);
+    }
+}
+
+std::string ResultsCache::get_key()
+{
+    std::ostringstream ss;
+    ss << std::hex;
+    ss.width(16);
+    ss.fill('0');
+    ss << key;
+    return ss.str();
+}
+
+bool ResultsCache::contains(const std::string& path)
+{
+    std::ifstream log(path);
+    std::string line;
+    while (std::getline(log, line))
+    {
+        if (line.rfind("================== END", 0) == 0)
+            return true;
+    }
+    return false;
+}
+
+uint64_t ResultsCache::hash_file(const std::string& path)
+{
+    std::error_code ec;
+    std::filesystem::path absolute = std::filesystem::absolute(path, ec);
+    uintmax_t size = std::filesystem::file_size(absolute, ec);
+    if (ec)
+        return fnv1a("missing");
+    long mtime = std::filesystem::last_write_time(absolute, ec).time_since_epoch().count();
+
+    // Memoized content hash, keyed by path, size and modification time
+    std::ifstream index(index_path);
+    uint64_t hash;
+    uintmax_t indexed_size;
+    long indexed_mtime;
+    std::string indexed_path;
+    while (index >> std::hex >> hash >> std::dec >> indexed_size >> indexed_mtime && std::getline(index >> std::ws, indexed_path))
+    {
+        if (indexed_path == absolute.string() && indexed_size == size && indexed_mtime == mtime)
+            return hash;
+    }
+
+    std::ifstream file(absolute, std::ios::binary);
+    std::vector<char> buffer(1 << 20);
+    hash = FNV_OFFSET;
+    while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0)
+        hash = fnv1a(buffer.data(), file.gcount(), hash);
+
+    std::ostringstream entry;
+    entry << std::hex << hash << std::dec << ' ' << size << ' ' << mtime << ' ' << absolute.string() << '\n';
+    std::ofstream out(index_path, std::ios::app);
+    out << entry.str();
+    return hash;
+}
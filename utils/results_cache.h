@@ -0,0 +1,33 @@
+#ifndef _RESULTS_CACHE_H
+#define _RESULTS_CACHE_H
+
+/**
+ * Results Cache
+ * Keys a run by a hash of the simulator binary, the content of every input
+ * file (traces) and the full configuration, so that a sweep can skip points
+ * whose log in results/ is already up to date.
+ * Content hashes of large inputs are memoized in results/.input_hashes by
+ * (path, size, modification time), so unchanged traces are not re-read.
+*/
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ResultsCache {
+private:
+    const std::string index_path = "results/.input_hashes";
+    uint64_t key;
+
+    uint64_t hash_file(const std::string& path);
+
+public:
+    ResultsCache(std::string configuration, std::vector<std::string> inputs);
+
+    // 16 hex digit key identifying this run
+    std::string get_key();
+    // True if the log at path exists and was completely written
+    bool contains(const std::string& path);
+};
+
+#endif // _RESULTS_CACHE_H
@@ -0,0 +1,62 @@
+#include "scheduler.h"
+
+#include <algorithm>
+
+Scheduler::Scheduler(SchedulingMode _policy, long _time_slice, int _num_cores, std::vector<TraceSource*> traces)
+: policy(_policy)
+, time_slice(_time_slice)
+, num_cores(_num_cores)
+{
+    for (size_t tid = 0; tid < traces.size(); ++tid)
+    {
+        threads.push_back(new SoftwareThread(tid, traces[tid]));
+        ready.push_back(threads.back());
+    }
+}
+
+SoftwareThread* Scheduler::next(int pid, SoftwareThread* current, bool finished)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (current != nullptr && !finished)
+    {
+        current->queued_at = dispatches;
+        ready.push_back(current);
+    }
+
+    auto chosen = ready.end();
+    if (policy == SchedulingMode::affinity)
+    {
+        // The longest waiting thread, unless fewer dispatches than cores have
+        // passed it over and a thread that last ran on this core is ready
+        chosen = ready.begin();
+        if (chosen != ready.end() && dispatches - (*chosen)->queued_at < num_cores)
+        {
+            auto affine = std::find_if(ready.begin(), ready.end(),
+                                       [pid](SoftwareThread* thread) { return thread->last_core == pid; });
+            if (affine != ready.end())
+                chosen = affine;
+        }
+    }
+    else
+    {
+        for (auto it = ready.begin(); it != ready.end(); ++it)
+        {
+            if (policy == SchedulingMode::pinned && (*it)->tid % num_cores != pid)
+                continue;
+            chosen = it;
+            break;
+        }
+    }
+    if (chosen == ready.end())
+        return nullptr;
+
+    SoftwareThread *thread = *chosen;
+    ready.erase(chosen);
+    ++dispatches;
+    ++thread->slices;
+    thread->migrated = thread->last_core != -1 && thread->last_core != pid;
+    if (thread->migrated)
+        ++thread->migrations;
+    thread->last_core = pid;
+    return thread;
+}
@@ -0,0 +1,67 @@
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+/**
+ * Scheduler
+ * Time-shares software threads, one trace each, over the simulated cores.
+ * A core runs a thread for `time_slice` cycles of its own clock, then puts it
+ * back on the ready queue and picks the next thread according to the policy:
+ * - pinned: only the threads pinned to this core (thread id modulo cores)
+ * - round-robin: the thread that has waited longest, wherever it last ran
+ * - affinity: the longest waiting thread that last ran on this core, unless
+ *   the longest waiting thread overall has been passed over by as many
+ *   dispatches as there are cores, which then runs here so that no thread
+ *   starves behind an affine one. Waiting is counted in dispatches because
+ *   the cores' clocks are not comparable on the free-running engine
+ * Cache contents stay with the core, so a thread that resumes on another core
+ * has migrated and refetches its working set there. A core retires once no
+ * thread is ready for it.
+*/
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "config.h"
+#include "trace.h"
+
+struct SoftwareThread {
+    int tid;
+    TraceSource *trace;
+    int last_core = -1;
+    long queued_at = 0; // dispatches of the scheduler when it joined the ready queue
+    bool migrated = false; // the current slice runs on another core than the previous one
+
+    // Statistics
+    long slices = 0;
+    long migrations = 0;
+    long accesses = 0;
+    long misses = 0;
+    long migrated_accesses = 0; // in the first slice after a migration
+    long migrated_misses = 0;
+
+    SoftwareThread(int _tid, TraceSource* _trace)
+    : tid(_tid)
+    , trace(_trace)
+    {}
+};
+
+class Scheduler {
+private:
+    std::mutex lock;
+    std::deque<SoftwareThread*> ready;
+    long dispatches = 0; // threads handed to a core so far
+
+public:
+    SchedulingMode policy;
+    long time_slice;
+    int num_cores;
+    std::vector<SoftwareThread*> threads;
+
+    Scheduler(SchedulingMode _policy, long _time_slice, int _num_cores, std::vector<TraceSource*> traces);
+    // Requeues the thread core pid ran unless it finished, and returns the
+    // thread pid runs next, nullptr if none is ready for it
+    SoftwareThread* next(int pid, SoftwareThread* current, bool finished);
+};
+
+#endif // _SCHEDULER_H
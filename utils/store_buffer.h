@@ -0,0 +1,63 @@
+#ifndef _STORE_BUFFER_H
+#define _STORE_BUFFER_H
+
+/**
+ * Store Buffer
+ * FIFO of a core's outstanding stores. A store updates the cache state right
+ * away but the core only waits for it when the buffer is full; its latency is
+ * paid in the background, one store after the other. Fences and atomic
+ * read-modify-writes drain the buffer, stalling until the last store is done.
+*/
+
+#include <algorithm>
+#include <deque>
+
+class StoreBuffer {
+private:
+    std::deque<long> completions; // clock at which each buffered store is done
+
+    void retire(long clock)
+    {
+        while (!completions.empty() && completions.front() <= clock)
+            completions.pop_front();
+    }
+
+public:
+    int capacity;
+
+    // Statistics
+    long count_full = 0;
+    long count_drain = 0;
+
+    StoreBuffer(int _capacity)
+    : capacity(_capacity)
+    {}
+
+    // Buffers a store issued at `clock` that takes `latency` cycles,
+    // returns the cycles the core stalls for a free entry
+    long push(long clock, long latency)
+    {
+        retire(clock);
+        long stall = 0;
+        if ((int)completions.size() >= capacity)
+        {
+            ++count_full;
+            stall = completions.front() - clock;
+            retire(completions.front());
+        }
+        long start = completions.empty() ? clock + stall : std::max(clock + stall, completions.back());
+        completions.push_back(start + latency);
+        return stall;
+    }
+
+    // Returns the cycles the core stalls until every buffered store is done
+    long drain(long clock)
+    {
+        ++count_drain;
+        long stall = completions.empty() ? 0 : std::max(0L, completions.back() - clock);
+        completions.clear();
+        return stall;
+    }
+};
+
+#endif // _STORE_BUFFER_H
@@ -0,0 +1,93 @@
+#include "tlb.h"
+
+// Physical memory is limited to 2GB so that tags still fit in an int
+const long PHYSICAL_MEMORY = 1l << 31;
+
+PageTable::PageTable(long _page_size, PagePolicy _policy, long cache_way_size)
+: rng(0)
+, page_size(_page_size)
+, policy(_policy)
+, num_frames(PHYSICAL_MEMORY / _page_size)
+, num_colors(std::max(1l, cache_way_size / _page_size))
+{
+    next_frame_of_color.resize(num_colors, 0);
+}
+
+long PageTable::get_frame(long vpn)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = frames.find(vpn);
+    if (it != frames.end())
+        return it->second;
+
+    long frame;
+    if (policy == PagePolicy::sequential)
+    {
+        frame = next_frame++;
+    }
+    else if (policy == PagePolicy::randomized)
+    {
+        do {
+            frame = rng() % num_frames;
+        } while (used_frames.count(frame) && (long)used_frames.size() < num_frames);
+    }
+    else
+    {
+        // Page coloring: keep the virtual page's color so that pages which do
+        // not conflict in the virtual address space do not conflict in the cache
+        long color = vpn % num_colors;
+        frame = color + num_colors * next_frame_of_color[color]++;
+    }
+    frame %= num_frames;
+    used_frames.insert(frame);
+    frames[vpn] = frame;
+    return frame;
+}
+
+TLB::TLB(int _num_entries, int _associativity, int _miss_latency, PageTable* _page_table)
+: num_sets(std::max(1, _num_entries / _associativity))
+, associativity(_associativity)
+, entries(num_sets)
+, page_table(_page_table)
+, miss_latency(_miss_latency)
+{}
+
+long TLB::translate(long vaddr, long& cycles)
+{
+    long page_size = page_table->page_size;
+    long vpn = vaddr / page_size;
+    long offset = vaddr % page_size;
+    std::vector<TLBEntry> &set = entries[vpn % num_sets];
+
+    ++count_access;
+    ++stamp;
+    for (TLBEntry &entry : set)
+    {
+        if (entry.vpn == vpn)
+        {
+            // TLB hit
+            entry.last_use = stamp;
+            return entry.frame * page_size + offset;
+        }
+    }
+
+    // TLB miss: walk the page table and replace the LRU entry
+    ++count_miss;
+    cycles += miss_latency;
+    long frame = page_table->get_frame(vpn);
+    if ((int)set.size() < associativity)
+    {
+        set.push_back({vpn, frame, stamp});
+    }
+    else
+    {
+        TLBEntry *lru = &set[0];
+        for (TLBEntry &entry : set)
+        {
+            if (entry.last_use < lru->last_use)
+                lru = &entry;
+        }
+        *lru = {vpn, frame, stamp};
+    }
+    return frame * page_size + offset;
+}
@@ -0,0 +1,70 @@
+#ifndef _TLB_H
+#define _TLB_H
+
+/**
+ * Address Translation
+ * Optional model in front of the caches: every trace address is treated as a
+ * virtual address, looked up in a per-core set-associative LRU TLB and mapped
+ * to a physical frame by a page table shared by all cores. Physical addresses
+ * are then used for set indexing, so page placement decides set conflicts.
+*/
+
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "config.h"
+
+class PageTable {
+private:
+    std::mutex lock;
+    std::unordered_map<long, long> frames; // virtual page number -> physical frame number
+    std::unordered_set<long> used_frames;
+    std::mt19937_64 rng;
+    long next_frame = 0;
+    std::vector<long> next_frame_of_color;
+
+public:
+    long page_size;
+    PagePolicy policy;
+    long num_frames;
+    long num_colors;
+
+    // cache_way_size is the number of bytes covered by one way of the cache (sets * block size)
+    PageTable(long _page_size, PagePolicy _policy, long cache_way_size);
+
+    // Returns the frame of vpn, allocating one on first touch
+    long get_frame(long vpn);
+};
+
+struct TLBEntry {
+    long vpn;
+    long frame;
+    long last_use;
+};
+
+class TLB {
+private:
+    int num_sets;
+    int associativity;
+    long stamp = 0;
+    std::vector<std::vector<TLBEntry>> entries;
+    PageTable *page_table;
+
+public:
+    int miss_latency;
+
+    // Statistics
+    long count_access = 0;
+    long count_miss = 0;
+
+    TLB(int _num_entries, int _associativity, int _miss_latency, PageTable* _page_table);
+
+    // Returns the physical address of vaddr and adds the TLB miss penalty to cycles
+    long translate(long vaddr, long& cycles);
+};
+
+#endif // _TLB_H
@@ -0,0 +1,586 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+TextTrace::TextTrace(FILE* _file, bool _is_pipe)
+: file(_file)
+, is_pipe(_is_pipe)
+{
+    failed = file == nullptr;
+}
+
+TextTrace::~TextTrace()
+{
+    if (file == nullptr)
+        return;
+    if (is_pipe)
+        pclose(file);
+    else
+        fclose(file);
+}
+
+bool TextTrace::next(TraceRecord& record)
+{
+    char line[128];
+    while (file != nullptr && fgets(line, sizeof(line), file) != nullptr)
+    {
+        char *label_end;
+        char *value_end;
+        record.label = strtoul(line, &label_end, 10);
+        if (label_end == line)
+        {
+            // Blank lines are allowed, anything else is malformed
+            if (strspn(line, " \t\r\n") == strlen(line))
+                continue;
+            failed = true;
+            return false;
+        }
+        record.value = strtol(label_end, &value_end, 16);
+        if (value_end == label_end)
+        {
+            failed = true;
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+BinaryTrace::BinaryTrace(FILE* _file)
+: file(_file)
+{}
+
+BinaryTrace::~BinaryTrace()
+{
+    fclose(file);
+}
+
+bool BinaryTrace::next(TraceRecord& record)
+{
+    uint8_t label;
+    int64_t value;
+    if (fread(&label, 1, 1, file) != 1)
+        return false;
+    if (fread(&value, sizeof(value), 1, file) != 1)
+    {
+        failed = true;
+        return false;
+    }
+    record.label = label;
+    record.value = value;
+    return true;
+}
+
+// Labels whose value is an address
+static bool has_address(uint32_t label)
+{
+    return label != 2 && label != 8;
+}
+
+CompressedTrace::CompressedTrace(FILE* _file)
+: file(_file)
+{}
+
+CompressedTrace::~CompressedTrace()
+{
+    fclose(file);
+}
+
+bool CompressedTrace::read_byte(uint8_t& byte)
+{
+    if (position == length)
+    {
+        length = fread(buffer, 1, sizeof(buffer), file);
+        position = 0;
+        if (length == 0)
+            return false;
+    }
+    byte = buffer[position++];
+    return true;
+}
+
+// Zigzag varint, 7 bits per byte with the low bits first
+bool CompressedTrace::read_varint(long& value)
+{
+    uint64_t raw = 0;
+    uint8_t byte = 0x80;
+    for (int shift = 0; byte & 0x80; shift += 7)
+    {
+        if (shift > 63 || !read_byte(byte))
+        {
+            failed = true;
+            return false;
+        }
+        raw |= (uint64_t)(byte & 0x7f) << shift;
+    }
+    value = (long)(raw >> 1) ^ -(long)(raw & 1);
+    return true;
+}
+
+void CompressedTrace::replay(const CompressedEntry& entry, TraceRecord& record)
+{
+    record.label = entry.label;
+    if (entry.label == 2)
+    {
+        record.value = entry.compute;
+        return;
+    }
+    record.value = 0;
+    if (has_address(entry.label))
+    {
+        slots[entry.slot] += entry.delta;
+        record.value = slots[entry.slot];
+    }
+    compute_pending = entry.compute;
+}
+
+bool CompressedTrace::next(TraceRecord& record)
+{
+    if (compute_pending >= 0)
+    {
+        record = {2, compute_pending};
+        compute_pending = -1;
+        return true;
+    }
+    if (repeat > 0)
+    {
+        --repeat;
+        replay(previous, record);
+        return true;
+    }
+
+    uint8_t header;
+    if (!read_byte(header))
+        return false;
+    CompressedEntry entry = {header & 0xfu, (header >> 4) & 0x3, 0, -1};
+    if (header & COMPRESSED_SHORT)
+    {
+        entry.label = (header >> 6) & 1;
+        if ((header & 0xf) != COMPRESSED_SHORT_NONE)
+            entry.compute = header & 0xf;
+    }
+    else if (entry.label == COMPRESSED_RUN)
+    {
+        long count;
+        if (!read_varint(count))
+            return false;
+        if (!has_previous || count < 1)
+        {
+            failed = true;
+            return false;
+        }
+        repeat = count - 1;
+        replay(previous, record);
+        return true;
+    }
+    if (has_address(entry.label) && !read_varint(entry.delta))
+        return false;
+    if (!(header & COMPRESSED_SHORT) && (header & 0x40) && !read_varint(entry.compute))
+        return false;
+    if (entry.label == 2 && entry.compute < 0)
+    {
+        failed = true;
+        return false;
+    }
+    previous = entry;
+    has_previous = true;
+    replay(entry, record);
+    return true;
+}
+
+CompressedTraceWriter::CompressedTraceWriter(FILE* _file)
+: file(_file)
+{
+    fwrite(COMPRESSED_TRACE_MAGIC, 1, sizeof(COMPRESSED_TRACE_MAGIC), file);
+}
+
+void CompressedTraceWriter::write_varint(long value)
+{
+    uint64_t raw = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+    while (raw >= 0x80)
+    {
+        fputc((int)(raw & 0x7f) | 0x80, file);
+        raw >>= 7;
+    }
+    fputc((int)raw, file);
+}
+
+bool CompressedTraceWriter::write(const TraceRecord& record)
+{
+    if (record.label >= COMPRESSED_RUN)
+        return false;
+    if (record.label == 2 && has_current && current.label != 2 && current.compute < 0)
+    {
+        current.compute = record.value;
+        return true;
+    }
+    finish();
+    current = {record.label, 0, 0, -1};
+    has_current = true;
+    if (record.label == 2)
+    {
+        current.compute = record.value;
+    }
+    else if (has_address(record.label))
+    {
+        // Nearest slot, or the least recently used one for a far jump
+        const long REACH = 4096;
+        int nearest = 0;
+        int oldest = 0;
+        for (int i = 1; i < COMPRESSED_SLOTS; ++i)
+        {
+            if (std::labs(record.value - slots[i]) < std::labs(record.value - slots[nearest]))
+                nearest = i;
+            if (slot_used[i] < slot_used[oldest])
+                oldest = i;
+        }
+        current.slot = std::labs(record.value - slots[nearest]) <= REACH ? nearest : oldest;
+        current.delta = record.value - slots[current.slot];
+        slots[current.slot] = record.value;
+        slot_used[current.slot] = ++clock;
+    }
+    return true;
+}
+
+void CompressedTraceWriter::finish()
+{
+    if (!has_current)
+        return;
+    has_current = false;
+    if (has_previous && current.label == previous.label && current.slot == previous.slot
+        && current.delta == previous.delta && current.compute == previous.compute)
+    {
+        ++run;
+        return;
+    }
+    flush_run();
+    bool compute = current.compute >= 0;
+    if (current.label <= 1 && current.compute < COMPRESSED_SHORT_NONE)
+    {
+        long cycles = compute ? current.compute : COMPRESSED_SHORT_NONE;
+        fputc((int)(COMPRESSED_SHORT | current.label << 6 | current.slot << 4 | cycles), file);
+        write_varint(current.delta);
+    }
+    else
+    {
+        fputc((int)(current.label | current.slot << 4 | (compute ? 0x40 : 0)), file);
+        if (has_address(current.label))
+            write_varint(current.delta);
+        if (compute)
+            write_varint(current.compute);
+    }
+    previous = current;
+    has_previous = true;
+}
+
+void CompressedTraceWriter::flush_run()
+{
+    if (run == 0)
+        return;
+    fputc((int)COMPRESSED_RUN, file);
+    write_varint(run);
+    run = 0;
+}
+
+void CompressedTraceWriter::close()
+{
+    finish();
+    flush_run();
+}
+
+TraceSource* open_trace(const std::string& path)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return new TextTrace(nullptr, false);
+
+    unsigned char magic[4] = {0, 0, 0, 0};
+    size_t length = fread(magic, 1, sizeof(magic), file);
+
+    const char *decompressor = nullptr;
+    if (length >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+        decompressor = "gzip -dc ";
+    else if (length >= 4 && magic[0] == 0xfd && magic[1] == '7' && magic[2] == 'z' && magic[3] == 'X')
+        decompressor = "xz -dc ";
+    else if (length >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+        decompressor = "zstd -dc ";
+
+    if (decompressor != nullptr)
+    {
+        fclose(file);
+        std::string quoted = "'";
+        for (char c : path)
+            quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+        quoted += "'";
+        return new TextTrace(popen((decompressor + quoted).c_str(), "r"), true);
+    }
+    if (length == sizeof(magic) && memcmp(magic, BINARY_TRACE_MAGIC, sizeof(magic)) == 0)
+        return new BinaryTrace(file);
+    if (length == sizeof(magic) && memcmp(magic, COMPRESSED_TRACE_MAGIC, sizeof(magic)) == 0)
+        return new CompressedTrace(file);
+
+    rewind(file);
+    return new TextTrace(file, false);
+}
+
+// Natural order: runs of digits compare by value, so t_2 comes before t_10
+static bool natural_less(const std::string& a, const std::string& b)
+{
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size())
+    {
+        if (isdigit((unsigned char)a[i]) && isdigit((unsigned char)b[j]))
+        {
+            size_t a_start = i;
+            size_t b_start = j;
+            while (a_start < a.size() - 1 && a[a_start] == '0' && isdigit((unsigned char)a[a_start + 1]))
+                ++a_start;
+            while (b_start < b.size() - 1 && b[b_start] == '0' && isdigit((unsigned char)b[b_start + 1]))
+                ++b_start;
+            i = a_start;
+            j = b_start;
+            while (i < a.size() && isdigit((unsigned char)a[i]))
+                ++i;
+            while (j < b.size() && isdigit((unsigned char)b[j]))
+                ++j;
+            // Without leading zeros, the shorter number is the smaller one
+            if (i - a_start != j - b_start)
+                return i - a_start < j - b_start;
+            int order = a.compare(a_start, i - a_start, b, b_start, j - b_start);
+            if (order != 0)
+                return order < 0;
+        }
+        else
+        {
+            if (a[i] != b[j])
+                return a[i] < b[j];
+            ++i;
+            ++j;
+        }
+    }
+    if (a.size() - i != b.size() - j)
+        return a.size() - i < b.size() - j;
+    return a < b;
+}
+
+bool read_manifest(const std::string& path, std::vector<std::string>& paths)
+{
+    paths.clear();
+    if (std::filesystem::is_directory(path))
+    {
+        for (const auto& entry : std::filesystem::directory_iterator(path))
+        {
+            if (entry.is_regular_file())
+                paths.push_back(entry.path().string());
+        }
+        std::sort(paths.begin(), paths.end(), natural_less);
+        return true;
+    }
+
+    // Relative trace paths are relative to the manifest's directory
+    std::filesystem::path base = std::filesystem::path(path).parent_path();
+    std::ifstream manifest(path);
+    std::string line;
+    int next_core = 0;
+    for (int line_num = 1; std::getline(manifest, line); ++line_num)
+    {
+        std::istringstream fields(line);
+        std::string first;
+        std::string second;
+        if (!(fields >> first) || first[0] == '#')
+            continue;
+        int core = next_core;
+        std::string trace = first;
+        if (fields >> second)
+        {
+            size_t end = 0;
+            try
+            {
+                core = std::stoi(first, &end);
+            }
+            catch (const std::exception&)
+            {
+                core = -1;
+            }
+            if (core < 0 || end != first.size())
+            {
+                std::cout << "ERROR: Malformed line " << line_num << " of manifest " << path << ": " << line << std::endl;
+                return false;
+            }
+            trace = second;
+        }
+        if (core >= (int)paths.size())
+            paths.resize(core + 1);
+        paths[core] = (base / trace).string();
+        next_core = core + 1;
+    }
+    return true;
+}
+
+bool validate_traces(const std::vector<std::string>& paths, long max_address, bool allow_missing)
+{
+    int num_traces = paths.size();
+    std::vector<std::string> errors(num_traces);
+    std::vector<bool> missing(num_traces, false);
+    std::vector<long> counts(num_traces, 0);
+    std::vector<long> min_addrs(num_traces, LONG_MAX);
+    std::vector<long> max_addrs(num_traces, 0);
+    std::atomic<int> next_trace = 0;
+
+    auto worker = [&]() {
+        for (int i = next_trace++; i < num_traces; i = next_trace++)
+        {
+            if (paths[i].empty())
+            {
+                errors[i] = "no trace given for this core";
+                continue;
+            }
+            if (allow_missing && !std::filesystem::exists(paths[i]))
+            {
+                missing[i] = true;
+                continue;
+            }
+            TraceSource *trace = open_trace(paths[i]);
+            TraceRecord record;
+            long &min_addr = min_addrs[i];
+            long &max_addr = max_addrs[i];
+            while (errors[i].empty() && trace->next(record))
+            {
+                ++counts[i];
+                if (record.label > MAX_LABEL)
+                    errors[i] = "label " + std::to_string(record.label) + " out of range at record " + std::to_string(counts[i]);
+                else if (record.value < 0)
+                    errors[i] = "negative value at record " + std::to_string(counts[i]);
+                else if (record.label != 2 && record.label != 8 && record.value > max_address)
+                    errors[i] = "address beyond the simulated address space at record " + std::to_string(counts[i]);
+                else if (record.label != 2 && record.label != 8)
+                {
+                    min_addr = std::min(min_addr, record.value);
+                    max_addr = std::max(max_addr, record.value);
+                }
+            }
+            if (errors[i].empty() && trace->failed)
+                errors[i] = "unreadable or malformed after " + std::to_string(counts[i]) + " records";
+            delete trace;
+        }
+    };
+
+    int num_threads = std::min<int>(num_traces, std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread &t : threads)
+        t.join();
+
+    bool valid = true;
+    long total = 0;
+    long min_addr = LONG_MAX;
+    long max_addr = 0;
+    for (int i = 0; i < num_traces; ++i)
+    {
+        total += counts[i];
+        min_addr = std::min(min_addr, min_addrs[i]);
+        max_addr = std::max(max_addr, max_addrs[i]);
+        if (missing[i])
+            std::cout << "WARNING: Trace of core " << i << " (" << paths[i] << ") not found, the core stays idle." << std::endl;
+        else if (!errors[i].empty())
+        {
+            std::cout << "ERROR: Trace of core " << i << " (" << paths[i] << "): " << errors[i] << "." << std::endl;
+            valid = false;
+        }
+    }
+    if (valid)
+        std::cout << "Validated " << num_traces << " trace(s), " << total << " records, addresses 0x"
+                  << std::hex << (min_addr == LONG_MAX ? 0 : min_addr) << "-0x" << max_addr << std::dec << std::endl;
+    return valid;
+}
+
+// The shared region starts at 0 and private regions follow it
+const long PRIVATE_BASE = 0x10000000;
+
+SyntheticTrace::SyntheticTrace(const SyntheticConfig& _config, int _pid, int _block_size)
+: config(_config)
+, pid(_pid)
+, block_size(_block_size)
+, state(_config.seed * 0x9E3779B97F4A7C15ull + _pid + 1)
+{}
+
+// xorshift64*, cheap enough to generate billions of records
+uint64_t SyntheticTrace::random()
+{
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1Dull;
+}
+
+// Next word-aligned offset into a region, walking by step or at random
+long SyntheticTrace::next_offset(long region_size, long step)
+{
+    long offset;
+    if (config.random_access)
+        offset = random() % region_size;
+    else
+        offset = (position * step) % region_size;
+    ++position;
+    return offset & ~3l;
+}
+
+bool SyntheticTrace::next(TraceRecord& record)
+{
+    if (compute_next)
+    {
+        compute_next = false;
+        record.label = 2;
+        record.value = 1 + random() % (2 * config.compute);
+        return true;
+    }
+    if (count >= config.accesses)
+        return false;
+    ++count;
+    compute_next = config.compute > 0;
+
+    long working_set = config.working_set;
+    bool read = (random() % 1000) < config.read_ratio * 1000;
+    long addr;
+    switch (config.pattern)
+    {
+        case SyntheticPattern::uniform:
+            if ((random() % 1000) < config.sharing * 1000)
+                addr = next_offset(working_set, config.stride);
+            else
+                addr = PRIVATE_BASE + pid * working_set + next_offset(working_set, config.stride);
+            break;
+        case SyntheticPattern::producer_consumer:
+            // Core 2k produces into buffer k, core 2k+1 consumes it
+            addr = (pid / 2) * working_set + next_offset(working_set, config.stride);
+            read = pid % 2 == 1;
+            break;
+        case SyntheticPattern::migratory:
+            // Read-modify-write of each shared block
+            addr = ((position / 2) * block_size) % working_set;
+            read = position % 2 == 0;
+            ++position;
+            break;
+        case SyntheticPattern::false_sharing:
+        default:
+            // Distinct words of the same block
+            addr = next_offset(working_set, block_size) / block_size * block_size + (pid * 4) % block_size;
+            break;
+    }
+    record.label = read ? 0 : 1;
+    record.value = addr;
+    return true;
+}
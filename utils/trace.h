@@ -0,0 +1,197 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+/**
+ * Trace Sources
+ * A core consumes (label, value) records from a trace source:
+ * label 0 = read of address value, 1 = write of address value,
+ * 2 = value compute cycles, 3 and 4 = non-temporal read and write of
+ * address value, which do not allocate in the cache when they miss,
+ * 5 = atomic read-modify-write, 6 = load-linked and 7 = store-conditional of
+ * address value, 8 = memory fence (value ignored).
+ * open_trace detects the format of a trace file:
+ * - text: the bundled "<label> <hex value>" lines
+ * - binary: "CCTB" followed by packed {uint8 label, int64 value} records
+ * - compressed: "CCTZ" followed by delta-encoded entries, see CompressedTrace
+ * - gzip, xz or zstd compressed text, decompressed through a pipe
+ * SyntheticTrace generates records on the fly without touching disk.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "config.h"
+
+const uint32_t MAX_LABEL = 8;
+const char BINARY_TRACE_MAGIC[4] = {'C', 'C', 'T', 'B'};
+const char COMPRESSED_TRACE_MAGIC[4] = {'C', 'C', 'T', 'Z'};
+
+struct TraceRecord {
+    uint32_t label;
+    long value;
+};
+
+class TraceSource {
+public:
+    bool failed = false; // set when the trace is unreadable or malformed
+
+    virtual ~TraceSource() {}
+    // Returns false once the trace is exhausted
+    virtual bool next(TraceRecord& record) = 0;
+};
+
+class TextTrace : public TraceSource {
+private:
+    FILE *file;
+    bool is_pipe;
+
+public:
+    TextTrace(FILE* _file, bool _is_pipe);
+    ~TextTrace();
+    bool next(TraceRecord& record);
+};
+
+class BinaryTrace : public TraceSource {
+private:
+    FILE *file;
+
+public:
+    // The magic has already been consumed from _file
+    BinaryTrace(FILE* _file);
+    ~BinaryTrace();
+    bool next(TraceRecord& record);
+};
+
+/**
+ * Compressed Trace
+ * Each entry is a header byte, then the address as a zigzag varint delta
+ * from one of 4 slots holding recent addresses, so that interleaved streams
+ * each stay close to their own slot. The slot takes the new address.
+ * A compute record that follows an access is folded into its entry.
+ * - Short access, bit 7 set: bit 6 = write, bits 4-5 = slot and bits 0-3 =
+ *   cycles of the compute record that follows, 15 = none.
+ * - Otherwise bits 0-3 = label, bits 4-5 = slot and bit 6 is set if a compute
+ *   record follows, its cycles as a zigzag varint after the address. A
+ *   compute record without an access before it is an entry of label 2.
+ * - Label 15 is a run: a varint n repeats the previous entry n more times,
+ *   with the same label, slot, address delta and compute cycles.
+ * Each trace file is one core's stream. Entries are decoded from a 64 KB
+ * read buffer.
+*/
+struct CompressedEntry {
+    uint32_t label;
+    int slot;
+    long delta;
+    long compute; // -1 = no compute record follows
+};
+
+const int COMPRESSED_SLOTS = 4;
+const uint32_t COMPRESSED_RUN = 15;
+const int COMPRESSED_SHORT = 0x80;
+const long COMPRESSED_SHORT_NONE = 15;
+
+class CompressedTrace : public TraceSource {
+private:
+    FILE *file;
+    unsigned char buffer[1 << 16];
+    size_t position = 0;
+    size_t length = 0;
+    long slots[COMPRESSED_SLOTS] = {};
+    CompressedEntry previous = {0, 0, 0, -1};
+    bool has_previous = false;
+    long repeat = 0;
+    long compute_pending = -1;
+
+    bool read_byte(uint8_t& byte);
+    bool read_varint(long& value);
+    void replay(const CompressedEntry& entry, TraceRecord& record);
+
+public:
+    // The magic has already been consumed from _file
+    CompressedTrace(FILE* _file);
+    ~CompressedTrace();
+    bool next(TraceRecord& record);
+};
+
+// Writes records in the compressed trace format, used by trace_convert
+class CompressedTraceWriter {
+private:
+    FILE *file;
+    long slots[COMPRESSED_SLOTS] = {};
+    long slot_used[COMPRESSED_SLOTS] = {};
+    long clock = 0;
+    CompressedEntry current = {0, 0, 0, -1};
+    bool has_current = false;
+    CompressedEntry previous = {0, 0, 0, -1};
+    bool has_previous = false;
+    long run = 0;
+
+    void write_varint(long value);
+    void finish();
+    void flush_run();
+
+public:
+    // Writes the magic to _file, which stays owned by the caller
+    CompressedTraceWriter(FILE* _file);
+    // Returns false if the label does not fit in the format
+    bool write(const TraceRecord& record);
+    // Writes the entries still buffered
+    void close();
+};
+
+// Opens a trace file of any supported format, never returns nullptr
+TraceSource* open_trace(const std::string& path);
+
+// Trace paths for each core, from a manifest file of "[<core>] <path>" lines
+// or from the regular files of a directory in natural name order (t_2 before
+// t_10). Returns false and prints the offending line if a core index is
+// malformed or negative
+bool read_manifest(const std::string& path, std::vector<std::string>& paths);
+
+// Scans all traces in parallel, checking labels and that addresses are below
+// max_address. Returns false and prints the problems if any trace is unusable.
+// With allow_missing, absent files only warn and simulate as empty traces.
+bool validate_traces(const std::vector<std::string>& paths, long max_address, bool allow_missing);
+
+struct SyntheticConfig {
+    long accesses = 1000000;    // memory accesses per core
+    long working_set = 65536;   // bytes, per region
+    double read_ratio = 0.7;
+    double sharing = 0.1;       // fraction of accesses to the shared region (uniform pattern)
+    SyntheticPattern pattern = SyntheticPattern::uniform;
+    bool random_access = false; // false = strided walk over the region
+    long stride = 4;            // bytes
+    long compute = 10;          // mean compute cycles between accesses, 0 = none
+    uint64_t seed = 1;
+};
+
+/**
+ * Synthetic Trace
+ * Patterns:
+ * - uniform: each access goes to the shared region with probability `sharing`,
+ *   otherwise to the core's private region.
+ * - producer_consumer: even cores write a buffer that the next odd core reads.
+ * - migratory: every core reads then writes the same shared blocks in turn.
+ * - false_sharing: every core accesses its own word of the same shared blocks.
+*/
+class SyntheticTrace : public TraceSource {
+private:
+    SyntheticConfig config;
+    int pid;
+    int block_size;
+    long count = 0;
+    long position = 0;
+    bool compute_next = false;
+    uint64_t state;
+
+    uint64_t random();
+    long next_offset(long region_size, long step);
+
+public:
+    SyntheticTrace(const SyntheticConfig& _config, int _pid, int _block_size);
+    bool next(TraceRecord& record);
+};
+
+#endif // _TRACE_H
@@ -0,0 +1,110 @@
+#ifndef _VICTIM_CACHE_H
+#define _VICTIM_CACHE_H
+
+/**
+ * Victim Cache
+ * Small fully associative LRU buffer behind a core's cache that catches the
+ * lines the cache evicts, dirty lines included, so a conflict miss on a
+ * recently evicted block is served without a bus transaction. Lines keep
+ * their coherence state and are snooped like cached lines; a dirty line is
+ * only written back once it falls out of the victim cache.
+ * The cache's set locks do not cover it, since it holds lines of every set,
+ * so it has its own lock, always taken last.
+*/
+
+#include <mutex>
+#include <vector>
+
+struct VictimLine {
+    int set_num;
+    int tag;
+    int status;
+    long stamp; // 0 = empty
+};
+
+class VictimCache {
+private:
+    std::mutex lock;
+    std::vector<VictimLine> lines;
+    long clock = 0;
+
+    VictimLine* find(int set_num, int tag)
+    {
+        for (VictimLine &line : lines)
+        {
+            if (line.stamp != 0 && line.set_num == set_num && line.tag == tag)
+                return &line;
+        }
+        return nullptr;
+    }
+
+public:
+    // Statistics
+    long count_probe = 0;
+    long count_hit = 0;
+    long count_dirty_hit = 0; // hits that also saved the write-back of a dirty line
+    long count_writeback = 0;
+
+    VictimCache(int _entries)
+    : lines(_entries, {0, 0, 0, 0})
+    {}
+
+    // Status of the block, -1 if absent
+    int get_status(int set_num, int tag)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        VictimLine *line = find(set_num, tag);
+        return line ? line->status : -1;
+    }
+
+    // Returns false if the block is absent
+    bool set_status(int set_num, int tag, int status)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        VictimLine *line = find(set_num, tag);
+        if (line)
+            line->status = status;
+        return line != nullptr;
+    }
+
+    void erase(int set_num, int tag)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        VictimLine *line = find(set_num, tag);
+        if (line)
+            line->stamp = 0;
+    }
+
+    // Removes the block for a miss of the cache, returns its status or -1
+    int take(int set_num, int tag)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        ++count_probe;
+        VictimLine *line = find(set_num, tag);
+        if (line == nullptr)
+            return -1;
+        ++count_hit;
+        line->stamp = 0;
+        return line->status;
+    }
+
+    // Stores an evicted line. Returns true and the displaced LRU line if the
+    // victim cache was full
+    bool insert(int set_num, int tag, int status, VictimLine& displaced)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        VictimLine *slot = &lines[0];
+        for (VictimLine &line : lines)
+        {
+            if (line.stamp < slot->stamp)
+                slot = &line;
+        }
+        bool full = slot->stamp != 0;
+        if (full)
+            displaced = *slot;
+        *slot = {set_num, tag, status, ++clock};
+        return full;
+    }
+};
+
+#endif // _VICTIM_CACHE_H